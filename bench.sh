@@ -0,0 +1,168 @@
+#!/bin/bash
+# Runs a benchmark kernel headless, scrapes its "BENCH <name> key=value..."
+# lines (see src/apps/bench.h) into JSON, and compares them to a baseline.
+#
+# usage: bench.sh <name> <outdir> <baseline.json> <tolerance %> <timeout s> -- <qemu command>
+#
+# BENCH_UPDATE=1 stores the results as the new baseline.
+# Exit status is non-zero if the run didn't complete, if it reported an
+# error, failures, a leak or not ok, if two lines of the run can't be told
+# apart, or if ok, failures or leak_blocks changed from the baseline.
+#
+# EXPERIMENTAL: only tested so far against a fake QEMU printing canned BENCH
+# lines, and no baseline has been recorded from a real QEMU run. Timings are
+# QEMU wall-clock times, noisy on a loaded build machine: a timing that grew
+# by more than tolerance percent (and more than one unit) is reported, but
+# only fails the run with BENCH_TIMING=1. Without a baseline, only the
+# checks of the run itself are done.
+#
+# QEMU does not emulate the cycle counter (it reads 0): cycle metrics
+# (cycles_per_op, *_cycles) are recorded but never compared.
+
+NAME=$1
+OUTDIR=$2
+BASELINE=$3
+TOLERANCE=$4
+TIMEOUT=$5
+shift 5
+[ "$1" = "--" ] && shift
+
+LOG="$OUTDIR/bench-$NAME.log"
+JSON="$OUTDIR/bench-$NAME.json"
+
+mkdir -p "$OUTDIR"
+
+# The kernel resets the board when done, which stops QEMU (-no-reboot)
+timeout "$TIMEOUT" "$@" < /dev/null | tr -d '\r' > "$LOG"
+
+if ! grep -q "^BENCH $NAME done" "$LOG"; then
+    echo "Benchmark did not complete, see $LOG"
+    exit 1
+fi
+
+# The run's own checks: they need no baseline
+if ! awk -v name="$NAME" '
+$1 == "BENCH" && $2 == name {
+    for (i = 3; i <= NF; i++) {
+        split($i, kv, "=")
+        if (kv[1] == "error" || (kv[1] == "failures" && kv[2] != 0) ||
+            (kv[1] == "leak_blocks" && kv[2] != 0) || (kv[1] == "ok" && kv[2] != 1)) {
+            print "FAILED     " $0; bad = 1
+        }
+    }
+}
+END { exit bad }' "$LOG"; then
+    echo "Benchmark reported failures, see $LOG"
+    exit 1
+fi
+
+# One metric per line: "<line identity>/<key>": value
+# The identity is made of the fields telling lines apart (test, size...).
+# Two lines with the same identity would hide each other: that's an error.
+if ! awk -v name="$NAME" '
+BEGIN {
+    split("test param size thread mode op phase round", k)
+    for (i in k) ident[k[i]] = 1
+    n = 0
+}
+$1 == "BENCH" && $2 == name && $3 != "done" {
+    id = ""
+    for (i = 3; i <= NF; i++) {
+        split($i, kv, "=")
+        if (kv[1] in ident) id = id (id == "" ? "" : ",") $i
+    }
+    for (i = 3; i <= NF; i++) {
+        split($i, kv, "=")
+        if (kv[1] in ident || kv[1] ~ /^hist_/ || kv[2] !~ /^[0-9]+$/) continue
+        key = (id == "" ? "" : id "/") kv[1]
+        if (key in seen) {
+            printf "DUPLICATE  %s\n", key > "/dev/stderr"; bad = 1
+        }
+        seen[key] = 1
+        metrics[n++] = "    \"" key "\": " kv[2]
+    }
+}
+END {
+    printf "{\n  \"bench\": \"%s\",\n  \"metrics\": {\n", name
+    for (i = 0; i < n; i++) printf "%s%s\n", metrics[i], (i < n - 1 ? "," : "")
+    printf "  }\n}\n"
+    exit bad
+}' "$LOG" > "$JSON"; then
+    echo "Results of $LOG can't be told apart: add the field telling them apart to bench.sh"
+    exit 1
+fi
+
+echo "Results: $JSON"
+
+if [ "$BENCH_UPDATE" = "1" ]; then
+    mkdir -p "$(dirname "$BASELINE")"
+    cp "$JSON" "$BASELINE"
+    echo "Baseline updated: $BASELINE"
+    exit 0
+fi
+
+if [ ! -f "$BASELINE" ]; then
+    echo "WARNING: no baseline ($BASELINE), the run was not compared to one"
+    echo "WARNING: record one with \"make bench-baseline BENCH=$NAME\" from a real QEMU run"
+    exit 0
+fi
+
+# Lower is better for times, latencies and fragmentation, higher for
+# throughputs. Some values must not change at all. Other metrics (counts,
+# cycles...) are informational.
+awk -v tol="$TOLERANCE" -v timing="$BENCH_TIMING" '
+BEGIN {
+    split("us ns_per_op min avg max p50 p90 p99 p999 worst_irqoff_us frag_bytes free_holes", k)
+    for (i in k) lower[k[i]] = 1
+    split("mbps", k)
+    for (i in k) higher[k[i]] = 1
+    split("ok failures leak_blocks", k)
+    for (i in k) exact[k[i]] = 1
+    bad = 0
+}
+/^    "/ {
+    line = $0
+    gsub(/^ *"|,$/, "", line)
+    key = line; sub(/": .*/, "", key)
+    val = line; sub(/.*": /, "", val)
+    if (FILENAME == ARGV[1]) { base[key] = val; next }
+    cur[key] = val
+}
+END {
+    for (key in base) {
+        metric = key; sub(/.*\//, "", metric)
+        if (metric == "cycles_per_op" || metric ~ /_cycles$/) continue
+        if (!(key in cur)) {
+            printf "MISSING    %s\n", key; bad = 1; continue
+        }
+        b = base[key] + 0; c = cur[key] + 0
+        if (metric in exact && c != b) {
+            printf "CHANGED    %s: %d -> %d\n", key, b, c; bad = 1
+        } else if (metric in lower && c > b + b * tol / 100 && c > b + 1) {
+            printf "REGRESSION %s: %d -> %d (+%d%%)\n", key, b, c, b ? (c - b) * 100 / b : 100
+            if (timing == "1") bad = 1
+        } else if (metric in higher && c < b - b * tol / 100 && c < b - 1) {
+            printf "REGRESSION %s: %d -> %d (-%d%%)\n", key, b, c, (b - c) * 100 / b
+            if (timing == "1") bad = 1
+        } else if ((metric in lower && c < b - b * tol / 100 && c < b - 1) ||
+                   (metric in higher && c > b + b * tol / 100 && c > b + 1)) {
+            printf "IMPROVED   %s: %d -> %d\n", key, b, c
+        }
+    }
+    exit bad
+}' "$BASELINE" "$JSON"
+STATUS=$?
+
+if [ "$BENCH_TIMING" = "1" ]; then
+    GATE="timings included"
+else
+    GATE="timings not gating, see BENCH_TIMING"
+fi
+
+if [ $STATUS -eq 0 ]; then
+    echo "Passed against $BASELINE (tolerance ${TOLERANCE}%, $GATE)"
+else
+    echo "Failed against $BASELINE (tolerance ${TOLERANCE}%, $GATE)"
+fi
+
+exit $STATUS
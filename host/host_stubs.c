@@ -0,0 +1,93 @@
+#define _POSIX_C_SOURCE 199309L
+
+/*
+ * Host replacements for the few kernel services the portable modules rely
+ * on. The host build is single-threaded: nothing ever preempts, so IRQ
+ * masking is a no-op, and blocking would be a deadlock.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../src/kernel/arm.h"
+#include "../src/kernel/pcb.h"
+#include "../src/kernel/pcb_turnstile.h"
+#include "../src/kernel/evset.h"
+#include "../src/kernel/bcm2835/uart.h"
+#include "../src/kernel/bcm2835/systimer.h"
+
+kernel_pcb_t * const pcb_running = 0;
+
+uint32_t irq_disable ( )
+{
+    return 0;
+}
+
+void irq_restore ( uint32_t irqmask )
+{
+    ( void ) irqmask;
+}
+
+uint32_t fiq_disable ( )
+{
+    return 0;
+}
+
+// No cycle counter on the host: nanoseconds instead
+uint32_t arm_get_cycle_count ( )
+{
+    struct timespec ts;
+    clock_gettime ( CLOCK_MONOTONIC, &ts );
+
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// No system timer on the host: monotonic microseconds instead
+uint32_t systimer_get_clock ( )
+{
+    struct timespec ts;
+    clock_gettime ( CLOCK_MONOTONIC, &ts );
+
+    return ts.tv_sec * 1000000ull + ts.tv_nsec / 1000;
+}
+
+int pcb_block ( kernel_pcb_t * pcb, kernel_pcb_turnstile_t * waitq,
+        uint32_t timeout )
+{
+    ( void ) pcb;
+    ( void ) waitq;
+
+    // Same as the kernel: a zero timeout gives up right away
+    if ( timeout == 0 )
+    {
+        return -1;
+    }
+
+    fprintf ( stderr, "pcb_block: would deadlock on the host\n" );
+    abort ( );
+}
+
+kernel_pcb_t * pcb_wakeup ( kernel_pcb_turnstile_t * waitq )
+{
+    return pcb_turnstile_popfront ( waitq );
+}
+
+void evset_notify ( evset_t set )
+{
+    ( void ) set;
+}
+
+void printu ( const char * str )
+{
+    fputs ( str, stdout );
+}
+
+void printuln ( const char * str )
+{
+    if ( str )
+    {
+        fputs ( str, stdout );
+    }
+    fputc ( '\n', stdout );
+}
@@ -0,0 +1,575 @@
+#define _POSIX_C_SOURCE 199309L
+
+/*
+ * Host benchmarks of the portable kernel modules: heap, turnstiles, mailbox
+ * ring, message queue, pipe, DWC2 FIFO sizing, configuration descriptor
+ * parsing and telemetry frames. Every
+ * benchmark checks its results along the way; the process exits with a
+ * non-zero status if any check fails.
+ *
+ * Results use the same format as the in-kernel benchmarks:
+ *     BENCH host test=<name> ops=<n> ns_per_op=<t>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../src/kernel/memory.h"
+#include "../src/kernel/pcb.h"
+#include "../src/kernel/pcb_turnstile.h"
+#include "../src/kernel/semaphore.h"
+#include "../src/kernel/mailbox.h"
+#include "../src/kernel/msgq.h"
+#include "../src/kernel/pipe.h"
+#include "../src/kernel/usb_core.h"
+#include "../src/kernel/telemetry_frame.h"
+#include "../src/kernel/bcm2835/usb_dwc2_fifos.h"
+#include "../src/kernel/config.h"
+
+// Filled by boot.s on the target
+extern unsigned char * kernel_memory_heap;
+
+static int hostbench_failures;
+
+#define CHECK(cond) \
+    do \
+    { \
+        if ( ! ( cond ) ) \
+        { \
+            printf ( "CHECK failed: %s:%d: %s\n", __FILE__, __LINE__, #cond ); \
+            hostbench_failures++; \
+        } \
+    } while ( 0 )
+
+static uint64_t hostbench_now ( )
+{
+    struct timespec ts;
+    clock_gettime ( CLOCK_MONOTONIC, &ts );
+
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void hostbench_report ( const char * test, uint64_t start, uint32_t ops )
+{
+    uint64_t ns = hostbench_now ( ) - start;
+
+    printf ( "BENCH host test=%s ops=%u ns_per_op=%llu\n", test, ops,
+            ( unsigned long long ) ( ops ? ns / ops : 0 ) );
+}
+
+static uint32_t hostbench_seed = 0x9e3779b9;
+
+static uint32_t hostbench_random ( )
+{
+    hostbench_seed ^= hostbench_seed << 13;
+    hostbench_seed ^= hostbench_seed >> 17;
+    hostbench_seed ^= hostbench_seed << 5;
+
+    return hostbench_seed;
+}
+
+/*
+ * Heap: random allocations and frees over a set of live blocks. Blocks are
+ * filled with a pattern, which must survive the other operations.
+ */
+#define HOSTBENCH_HEAP_SLOTS 512
+#define HOSTBENCH_HEAP_ROUNDS 200000
+
+static void hostbench_heap ( )
+{
+    static uint8_t * slots [ HOSTBENCH_HEAP_SLOTS ];
+    static uint32_t sizes [ HOSTBENCH_HEAP_SLOTS ];
+    uint32_t used_bytes = 0;
+
+    struct memory_stats initial;
+    memory_get_stats ( &initial );
+
+    uint64_t start = hostbench_now ( );
+
+    for ( uint32_t i = 0 ; i < HOSTBENCH_HEAP_ROUNDS ; ++i )
+    {
+        uint32_t slot = hostbench_random ( ) % HOSTBENCH_HEAP_SLOTS;
+
+        if ( slots [ slot ] )
+        {
+            // Pattern still there?
+            CHECK ( slots [ slot ] [ 0 ] == ( uint8_t ) slot );
+            CHECK ( slots [ slot ] [ sizes [ slot ] - 1 ] == ( uint8_t ) slot );
+
+            memory_deallocate ( slots [ slot ] );
+            used_bytes -= ( sizes [ slot ] + 3 ) & ~3;
+            slots [ slot ] = 0;
+            continue;
+        }
+
+        uint32_t size = 1 + hostbench_random ( ) % 4096;
+        slots [ slot ] = memory_allocate ( size );
+        CHECK ( slots [ slot ] );
+
+        if ( slots [ slot ] )
+        {
+            sizes [ slot ] = size;
+            used_bytes += ( size + 3 ) & ~3;
+            slots [ slot ] [ 0 ] = slot;
+            slots [ slot ] [ size - 1 ] = slot;
+        }
+    }
+
+    hostbench_report ( "heap", start, HOSTBENCH_HEAP_ROUNDS );
+
+    struct memory_stats stats;
+    memory_get_stats ( &stats );
+    CHECK ( stats.used_bytes == initial.used_bytes + used_bytes );
+
+    for ( uint32_t i = 0 ; i < HOSTBENCH_HEAP_SLOTS ; ++i )
+    {
+        if ( slots [ i ] )
+        {
+            memory_deallocate ( slots [ i ] );
+        }
+    }
+
+    memory_get_stats ( &stats );
+    CHECK ( stats.used_blocks == initial.used_blocks );
+    CHECK ( stats.free_holes == initial.free_holes );
+}
+
+/*
+ * Turnstiles: sorted insertion by wake up date, then pop in order.
+ */
+#define HOSTBENCH_TURNSTILE_PCBS 256
+#define HOSTBENCH_TURNSTILE_ROUNDS 200
+
+static void hostbench_turnstile ( )
+{
+    static kernel_pcb_t pcbs [ HOSTBENCH_TURNSTILE_PCBS ];
+    kernel_pcb_turnstile_t turnstile;
+
+    uint64_t start = hostbench_now ( );
+
+    for ( int r = 0 ; r < HOSTBENCH_TURNSTILE_ROUNDS ; ++r )
+    {
+        pcb_turnstile_init ( &turnstile );
+
+        for ( int i = 0 ; i < HOSTBENCH_TURNSTILE_PCBS ; ++i )
+        {
+            pcbs [ i ].mWakeUpDate = hostbench_random ( ) % 100000;
+            pcb_turnstile_sorted_insert ( & ( pcbs [ i ] ), &turnstile );
+        }
+
+        uint32_t last = 0;
+        int count = 0;
+        kernel_pcb_t * pcb;
+
+        while ( ( pcb = pcb_turnstile_popfront ( &turnstile ) ) )
+        {
+            CHECK ( pcb -> mWakeUpDate >= last );
+            last = pcb -> mWakeUpDate;
+            count++;
+        }
+
+        CHECK ( count == HOSTBENCH_TURNSTILE_PCBS );
+        CHECK ( pcb_turnstile_empty ( &turnstile ) );
+    }
+
+    hostbench_report ( "turnstile_sorted", start,
+            HOSTBENCH_TURNSTILE_ROUNDS * HOSTBENCH_TURNSTILE_PCBS );
+}
+
+/*
+ * Mailbox ring: bursts of sends then receives, never beyond the capacity
+ * (that would block), messages must come out in order.
+ */
+#define HOSTBENCH_MAILBOX_CAPACITY 64
+#define HOSTBENCH_MAILBOX_MSGS 1000000
+
+static void hostbench_mailbox ( )
+{
+    mailbox_t mbox = mailbox_create ( HOSTBENCH_MAILBOX_CAPACITY );
+    CHECK ( mbox >= 0 );
+    if ( mbox < 0 )
+    {
+        return;
+    }
+
+    int sent = 0;
+    int received = 0;
+
+    uint64_t start = hostbench_now ( );
+
+    while ( received < HOSTBENCH_MAILBOX_MSGS )
+    {
+        int burst = 1 + hostbench_random ( ) % HOSTBENCH_MAILBOX_CAPACITY;
+
+        for ( int i = 0 ; i < burst ; ++i )
+        {
+            CHECK ( mailbox_send ( mbox, sent++ ) == 0 );
+        }
+
+        for ( int i = 0 ; i < burst ; ++i )
+        {
+            int msg;
+            CHECK ( mailbox_recv_timeout ( mbox, &msg, 0 ) == 0 );
+            CHECK ( msg == received++ );
+        }
+    }
+
+    hostbench_report ( "mailbox", start, HOSTBENCH_MAILBOX_MSGS );
+
+    // Empty mailbox: a zero timeout gives up right away
+    int msg;
+    CHECK ( mailbox_recv_timeout ( mbox, &msg, 0 ) == -1 );
+
+    mailbox_destroy ( mbox );
+}
+
+/*
+ * Message queue: numbered messages, sent and received in random batches,
+ * never more than there is room for or messages to receive (that would
+ * block). They must come out in order.
+ */
+#define HOSTBENCH_MSGQ_CAPACITY 61
+#define HOSTBENCH_MSGQ_MSGS 2000000
+
+static void hostbench_msgq ( )
+{
+    void * msgs [ HOSTBENCH_MSGQ_CAPACITY ];
+
+    msgq_t q = msgq_create ( HOSTBENCH_MSGQ_CAPACITY );
+    CHECK ( q >= 0 );
+    if ( q < 0 )
+    {
+        return;
+    }
+
+    uintptr_t next_send = 0;
+    uintptr_t next_recv = 0;
+    uint32_t bad = 0;
+
+    uint64_t start = hostbench_now ( );
+
+    while ( next_recv < HOSTBENCH_MSGQ_MSGS )
+    {
+        uint32_t room = HOSTBENCH_MSGQ_CAPACITY - msgq_count ( q );
+        uint32_t n = room ? 1 + hostbench_random ( ) % room : 0;
+
+        for ( uint32_t i = 0 ; i < n ; ++i )
+        {
+            msgs [ i ] = ( void * ) next_send++;
+        }
+
+        if ( msgq_send_many ( q, msgs, n ) != ( int ) n )
+        {
+            bad++;
+        }
+
+        // Asks for more than there is at times: gets what there is
+        n = 1 + hostbench_random ( ) % HOSTBENCH_MSGQ_CAPACITY;
+        uint32_t count = msgq_count ( q );
+        int len = msgq_recv_many_timeout ( q, msgs, n, 0 );
+
+        // An empty queue times out right away
+        int expected = count ? ( int ) ( n < count ? n : count ) : -1;
+        if ( len != expected )
+        {
+            bad++;
+            continue;
+        }
+
+        for ( int i = 0 ; i < len ; ++i )
+        {
+            if ( msgs [ i ] != ( void * ) next_recv++ )
+            {
+                bad++;
+                break;
+            }
+        }
+    }
+
+    hostbench_report ( "msgq", start, next_recv );
+
+    CHECK ( bad == 0 );
+
+    // Nothing to move: neither call waits, both return 0
+    CHECK ( msgq_send_many ( q, msgs, 0 ) == 0 );
+    CHECK ( msgq_recv_many ( q, msgs, 0 ) == 0 );
+
+    msgq_destroy ( q );
+    CHECK ( msgq_send_many ( q, msgs, 0 ) == -1 );
+    CHECK ( msgq_recv_many ( q, msgs, 0 ) == -1 );
+    CHECK ( msgq_send ( q, msgs [ 0 ] ) == -1 );
+}
+
+/*
+ * Pipe: a stream of bytes, written and read back in random chunks, never
+ * more than there is room for or data to read (that would block). The ring
+ * wraps around all along, and chunks go beyond KERNEL_PIPE_MAX_BATCH: the
+ * bytes must come out in order.
+ */
+#define HOSTBENCH_PIPE_CAPACITY 1021
+#define HOSTBENCH_PIPE_BYTES 10000000
+
+static void hostbench_pipe ( )
+{
+    static uint8_t buf [ HOSTBENCH_PIPE_CAPACITY ];
+
+    pipe_t p = pipe_create ( HOSTBENCH_PIPE_CAPACITY );
+    CHECK ( p >= 0 );
+    if ( p < 0 )
+    {
+        return;
+    }
+
+    uint8_t next_write = 0;
+    uint8_t next_read = 0;
+    uint32_t received = 0;
+    uint32_t bad = 0;
+
+    uint64_t start = hostbench_now ( );
+
+    while ( received < HOSTBENCH_PIPE_BYTES )
+    {
+        uint32_t room = HOSTBENCH_PIPE_CAPACITY - pipe_count ( p );
+        uint32_t n = room ? 1 + hostbench_random ( ) % room : 0;
+
+        for ( uint32_t i = 0 ; i < n ; ++i )
+        {
+            buf [ i ] = next_write++;
+        }
+
+        if ( pipe_write ( p, buf, n ) != ( int ) n )
+        {
+            bad++;
+        }
+
+        // Asks for more than there is at times: gets what there is
+        n = 1 + hostbench_random ( ) % HOSTBENCH_PIPE_CAPACITY;
+        uint32_t count = pipe_count ( p );
+        int len = pipe_read ( p, buf, n );
+
+        if ( len != ( int ) ( n < count ? n : count ) )
+        {
+            bad++;
+            continue;
+        }
+
+        for ( int i = 0 ; i < len ; ++i )
+        {
+            if ( buf [ i ] != next_read++ )
+            {
+                bad++;
+                break;
+            }
+        }
+
+        received += len;
+    }
+
+    hostbench_report ( "pipe", start, received );
+
+    CHECK ( bad == 0 );
+
+    // Nothing to move: neither call waits
+    CHECK ( pipe_write ( p, buf, 0 ) == 0 );
+    CHECK ( pipe_read ( p, buf, 0 ) == 0 );
+
+    pipe_destroy ( p );
+    CHECK ( pipe_write ( p, buf, 1 ) == -1 );
+    CHECK ( pipe_read ( p, buf, 1 ) == -1 );
+    CHECK ( pipe_create ( 0 ) == -1 );
+}
+
+/*
+ * DWC2 FIFO sizing: the whole space is given away, no FIFO exceeds its max.
+ */
+#define HOSTBENCH_FIFOS_ROUNDS 100000
+
+static void hostbench_fifos ( )
+{
+    uint64_t start = hostbench_now ( );
+
+    for ( int r = 0 ; r < HOSTBENCH_FIFOS_ROUNDS ; ++r )
+    {
+        uint32_t sizes [ NB_FIFOS ] = { 0, 0, 0 };
+        uint32_t total = 0;
+
+        fifos_t fifos;
+        for ( int i = 0 ; i < NB_FIFOS ; ++i )
+        {
+            fifos [ i ].size = & ( sizes [ i ] );
+            fifos [ i ].max = 16 + hostbench_random ( ) % 4096;
+            total += fifos [ i ].max;
+        }
+
+        // Resizing only happens when the FIFOs don't fit
+        uint32_t space = 1 + hostbench_random ( ) % ( total - 1 );
+        dwc2_resize_fifos ( fifos, space );
+
+        CHECK ( sizes [ 0 ] + sizes [ 1 ] + sizes [ 2 ] == space );
+        for ( int i = 0 ; i < NB_FIFOS ; ++i )
+        {
+            CHECK ( sizes [ i ] <= fifos [ i ].max );
+        }
+    }
+
+    hostbench_report ( "dwc2_resize_fifos", start, HOSTBENCH_FIFOS_ROUNDS );
+}
+
+/*
+ * Configuration descriptor: two interfaces, with one and two endpoints.
+ */
+#define HOSTBENCH_CONF_ROUNDS 1000000
+
+static const uint8_t hostbench_conf [ ] =
+{
+    9, USB_DESC_CONF, 41, 0, 2, 1, 0, 0xe0, 1,
+    9, USB_DESC_INTF, 0, 0, 1, 9, 0, 0, 0,
+    7, USB_DESC_ENDP, 0x81, 3, 8, 0, 12,
+    9, USB_DESC_INTF, 1, 0, 2, 0xff, 0, 0, 0,
+    7, USB_DESC_ENDP, 0x82, 2, 0, 2, 0,
+};
+
+static void hostbench_conf_desc ( )
+{
+    static uint8_t conf [ 64 ];
+    struct usb_device dev;
+
+    memcpy ( conf, hostbench_conf, sizeof ( hostbench_conf ) );
+
+    uint64_t start = hostbench_now ( );
+
+    for ( int r = 0 ; r < HOSTBENCH_CONF_ROUNDS ; ++r )
+    {
+        memset ( &dev, 0, sizeof ( dev ) );
+        dev.conf_desc = ( struct usb_conf_desc * ) conf;
+
+        CHECK ( usb_parse_conf_desc ( &dev ) == USB_STATUS_SUCCESS );
+    }
+
+    hostbench_report ( "usb_parse_conf_desc", start, HOSTBENCH_CONF_ROUNDS );
+
+    CHECK ( dev.intf_desc [ 0 ] == ( void * ) ( conf + 9 ) );
+    CHECK ( dev.intf_desc [ 1 ] == ( void * ) ( conf + 25 ) );
+    CHECK ( dev.endp_desc [ 0 ] [ 0 ] == ( void * ) ( conf + 18 ) );
+    CHECK ( dev.endp_desc [ 1 ] [ 0 ] == ( void * ) ( conf + 34 ) );
+    CHECK ( dev.endp_desc [ 1 ] [ 1 ] == 0 );
+
+    // The last endpoint must lie within wTotalLength
+    conf [ 2 ] = sizeof ( hostbench_conf ) - 1;
+    memset ( &dev, 0, sizeof ( dev ) );
+    dev.conf_desc = ( struct usb_conf_desc * ) conf;
+    CHECK ( usb_parse_conf_desc ( &dev ) == -1 );
+
+    // And so must the header of a descriptor
+    conf [ 2 ] = sizeof ( hostbench_conf ) - 6;
+    memset ( &dev, 0, sizeof ( dev ) );
+    dev.conf_desc = ( struct usb_conf_desc * ) conf;
+    CHECK ( usb_parse_conf_desc ( &dev ) == -1 );
+
+    // A zero bLength must be rejected, not loop forever
+    memcpy ( conf, hostbench_conf, sizeof ( hostbench_conf ) );
+    conf [ 18 ] = 0;
+    memset ( &dev, 0, sizeof ( dev ) );
+    dev.conf_desc = ( struct usb_conf_desc * ) conf;
+    CHECK ( usb_parse_conf_desc ( &dev ) == -1 );
+}
+
+/*
+ * Telemetry frames: random payloads, with runs of zeros and of non-zero
+ * bytes longer than a COBS block, must come back intact. A flipped bit
+ * must be caught.
+ */
+#define HOSTBENCH_FRAME_ROUNDS 100000
+
+static void hostbench_telemetry ( )
+{
+    static uint8_t payload [ TELEMETRY_MAX_PAYLOAD ];
+    static uint8_t frame [ TELEMETRY_FRAME_MAX ];
+    static uint8_t raw [ TELEMETRY_RAW_MAX ];
+    uint32_t bad = 0;
+
+    uint64_t start = hostbench_now ( );
+
+    for ( uint32_t round = 0 ; round < HOSTBENCH_FRAME_ROUNDS ; ++round )
+    {
+        uint32_t n = hostbench_random ( ) % ( TELEMETRY_MAX_PAYLOAD + 1 );
+        uint32_t zeros = hostbench_random ( ) % 4;
+
+        for ( uint32_t i = 0 ; i < n ; ++i )
+        {
+            // From no zero at all to mostly zeros
+            payload [ i ] = ( hostbench_random ( ) % 4 < zeros ) ?
+                0 : 1 + hostbench_random ( ) % 255;
+        }
+
+        uint8_t channel = round;
+        uint8_t seq = round >> 8;
+        uint32_t size = telemetry_frame_encode ( channel, seq, payload, n, frame );
+
+        if ( size > TELEMETRY_FRAME_MAX || frame [ 0 ] != 0 ||
+                frame [ size - 1 ] != 0 || memchr ( frame + 1, 0, size - 2 ) )
+        {
+            bad++;
+            continue;
+        }
+
+        int len = telemetry_frame_decode ( frame + 1, size - 2, raw );
+        if ( len != ( int ) n || raw [ 0 ] != channel || raw [ 1 ] != seq ||
+                memcmp ( raw + 2, payload, n ) )
+        {
+            bad++;
+            continue;
+        }
+
+        // Flip a bit, but keep the frame free of zeros
+        uint32_t at = 1 + hostbench_random ( ) % ( size - 2 );
+        uint8_t flip = 1 << ( hostbench_random ( ) % 8 );
+        if ( frame [ at ] != flip )
+        {
+            frame [ at ] ^= flip;
+            if ( telemetry_frame_decode ( frame + 1, size - 2, raw ) >= 0 )
+            {
+                bad++;
+            }
+        }
+    }
+
+    hostbench_report ( "telemetry_frame", start, HOSTBENCH_FRAME_ROUNDS );
+
+    CHECK ( bad == 0 );
+
+    // Garbage and text must not pass for frames
+    CHECK ( telemetry_frame_decode ( ( const uint8_t * ) "Welcome!", 8, raw ) == -1 );
+    CHECK ( telemetry_frame_decode ( frame + 1, 0, raw ) == -1 );
+}
+
+int main ( )
+{
+    kernel_memory_heap = malloc ( KERNEL_HEAP_SIZE );
+    if ( ! kernel_memory_heap )
+    {
+        return 1;
+    }
+
+    memory_init ( );
+    sem_init ( );
+    mailbox_init ( );
+    msgq_init ( );
+    pipe_init ( );
+
+    hostbench_heap ( );
+    hostbench_turnstile ( );
+    hostbench_mailbox ( );
+    hostbench_msgq ( );
+    hostbench_pipe ( );
+    hostbench_fifos ( );
+    hostbench_conf_desc ( );
+    hostbench_telemetry ( );
+
+    printf ( "BENCH host failures=%d\n", hostbench_failures );
+    printf ( "BENCH host done\n" );
+
+    return hostbench_failures ? 1 : 0;
+}
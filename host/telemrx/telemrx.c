@@ -0,0 +1,272 @@
+#define _DEFAULT_SOURCE
+
+/*
+ * Telemetry receiver: reads the kernel console (a serial device, or stdin
+ * with "-"), passes the text through to stdout and decodes the telemetry
+ * frames (see src/kernel/telemetry.h).
+ *
+ *     telemrx [-b baud] [-o dir] <device|->
+ *
+ * Frames are printed as lines:
+ *     TELEMETRY ch=<channel> seq=<n> len=<bytes> data=<hex>
+ * or, with -o, their payload is appended to dir/ch<channel>.bin. Lost and
+ * corrupted frames are reported on stderr.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "../../src/kernel/telemetry_frame.h"
+#include "../../src/kernel/telemetry.h"
+
+// Bytes after a delimiter, until the next one
+static uint8_t telemrx_segment [ TELEMETRY_FRAME_MAX ];
+static uint32_t telemrx_segment_len;
+static int telemrx_in_frame;
+
+static int telemrx_seq [ TELEMETRY_CHANNELS ];
+static const char * telemrx_outdir;
+
+static unsigned long telemrx_frames;
+static unsigned long telemrx_lost;
+static unsigned long telemrx_bad;
+
+static const struct
+{
+    int baud;
+    speed_t speed;
+} telemrx_speeds [ ] =
+{
+    { 9600, B9600 }, { 19200, B19200 }, { 38400, B38400 },
+    { 57600, B57600 }, { 115200, B115200 }, { 230400, B230400 },
+    { 460800, B460800 }, { 921600, B921600 }, { 1000000, B1000000 },
+    { 1500000, B1500000 }, { 2000000, B2000000 }, { 3000000, B3000000 },
+};
+
+static int telemrx_open ( const char * path, int baud )
+{
+    if ( strcmp ( path, "-" ) == 0 )
+    {
+        return STDIN_FILENO;
+    }
+
+    int fd = open ( path, O_RDONLY | O_NOCTTY );
+    if ( fd < 0 )
+    {
+        perror ( path );
+        return -1;
+    }
+
+    struct termios tio;
+    if ( tcgetattr ( fd, &tio ) < 0 )
+    {
+        perror ( "tcgetattr" );
+        close ( fd );
+        return -1;
+    }
+
+    cfmakeraw ( &tio );
+    tio.c_cc [ VMIN ] = 1;
+    tio.c_cc [ VTIME ] = 0;
+
+    for ( size_t i = 0 ; i < sizeof ( telemrx_speeds ) / sizeof ( telemrx_speeds [ 0 ] ) ; ++i )
+    {
+        if ( telemrx_speeds [ i ].baud == baud )
+        {
+            cfsetispeed ( &tio, telemrx_speeds [ i ].speed );
+            cfsetospeed ( &tio, telemrx_speeds [ i ].speed );
+
+            if ( tcsetattr ( fd, TCSANOW, &tio ) < 0 )
+            {
+                perror ( "tcsetattr" );
+                close ( fd );
+                return -1;
+            }
+
+            return fd;
+        }
+    }
+
+    fprintf ( stderr, "telemrx: unsupported baud rate %d\n", baud );
+    close ( fd );
+    return -1;
+}
+
+static void telemrx_frame ( const uint8_t * raw, int len )
+{
+    uint8_t channel = raw [ 0 ];
+    uint8_t seq = raw [ 1 ];
+
+    // Sequence numbers are 8 bits: count the frames skipped since the last
+    if ( telemrx_seq [ channel ] >= 0 && seq != telemrx_seq [ channel ] )
+    {
+        uint8_t lost = seq - telemrx_seq [ channel ];
+        fprintf ( stderr, "telemrx: ch=%u lost %u frames\n", channel, lost );
+        telemrx_lost += lost;
+    }
+    telemrx_seq [ channel ] = ( uint8_t ) ( seq + 1 );
+    telemrx_frames++;
+
+    if ( telemrx_outdir )
+    {
+        char path [ 4096 ];
+        snprintf ( path, sizeof ( path ), "%s/ch%u.bin", telemrx_outdir, channel );
+
+        FILE * f = fopen ( path, "ab" );
+        if ( ! f )
+        {
+            perror ( path );
+            return;
+        }
+
+        fwrite ( raw + 2, 1, len, f );
+        fclose ( f );
+        return;
+    }
+
+    printf ( "TELEMETRY ch=%u seq=%u len=%d data=", channel, seq, len );
+    for ( int i = 0 ; i < len ; ++i )
+    {
+        printf ( "%02x", raw [ 2 + i ] );
+    }
+    printf ( "\n" );
+}
+
+/*
+ * A delimiter ends the segment: either a frame, or text that lost its frame
+ * delimiter (or a corrupted frame), printed as is.
+ */
+static void telemrx_segment_end ( )
+{
+    uint8_t raw [ TELEMETRY_RAW_MAX ];
+
+    int len = telemetry_frame_decode ( telemrx_segment, telemrx_segment_len, raw );
+    if ( len >= 0 )
+    {
+        telemrx_frame ( raw, len );
+        telemrx_in_frame = 0;
+    }
+    else
+    {
+        fprintf ( stderr, "telemrx: %u bytes are not a valid frame\n",
+                telemrx_segment_len );
+        fwrite ( telemrx_segment, 1, telemrx_segment_len, stdout );
+        telemrx_bad++;
+    }
+
+    telemrx_segment_len = 0;
+}
+
+static void telemrx_byte ( uint8_t b )
+{
+    if ( ! telemrx_in_frame )
+    {
+        // Text goes through right away, until a frame starts
+        if ( b == 0 )
+        {
+            telemrx_in_frame = 1;
+            fflush ( stdout );
+        }
+        else
+        {
+            putchar ( b );
+        }
+        return;
+    }
+
+    if ( b == 0 )
+    {
+        // Two delimiters in a row: the start of the next frame
+        if ( telemrx_segment_len )
+        {
+            telemrx_segment_end ( );
+        }
+        return;
+    }
+
+    // Too long for a frame: this was text
+    if ( telemrx_segment_len == sizeof ( telemrx_segment ) )
+    {
+        fwrite ( telemrx_segment, 1, telemrx_segment_len, stdout );
+        telemrx_segment_len = 0;
+        telemrx_in_frame = 0;
+        putchar ( b );
+        return;
+    }
+
+    telemrx_segment [ telemrx_segment_len++ ] = b;
+}
+
+static void telemrx_usage ( )
+{
+    fprintf ( stderr, "usage: telemrx [-b baud] [-o dir] <device|->\n" );
+}
+
+int main ( int argc, char * * argv )
+{
+    int baud = 115200;
+    int opt;
+
+    while ( ( opt = getopt ( argc, argv, "b:o:" ) ) != -1 )
+    {
+        switch ( opt )
+        {
+            case 'b':
+                baud = atoi ( optarg );
+                break;
+            case 'o':
+                telemrx_outdir = optarg;
+                break;
+            default:
+                telemrx_usage ( );
+                return 2;
+        }
+    }
+
+    if ( optind != argc - 1 )
+    {
+        telemrx_usage ( );
+        return 2;
+    }
+
+    int fd = telemrx_open ( argv [ optind ], baud );
+    if ( fd < 0 )
+    {
+        return 1;
+    }
+
+    for ( int i = 0 ; i < TELEMETRY_CHANNELS ; ++i )
+    {
+        telemrx_seq [ i ] = -1;
+    }
+
+    uint8_t buf [ 4096 ];
+    for ( ; ; )
+    {
+        ssize_t n = read ( fd, buf, sizeof ( buf ) );
+        if ( n < 0 && errno == EINTR )
+        {
+            continue;
+        }
+        if ( n <= 0 )
+        {
+            break;
+        }
+
+        for ( ssize_t i = 0 ; i < n ; ++i )
+        {
+            telemrx_byte ( buf [ i ] );
+        }
+        fflush ( stdout );
+    }
+
+    fprintf ( stderr, "telemrx: %lu frames, %lu lost, %lu invalid\n",
+            telemrx_frames, telemrx_lost, telemrx_bad );
+
+    return 0;
+}
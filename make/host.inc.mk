@@ -0,0 +1,36 @@
+#--------HOST BUILD--------#
+# "make host" builds the hardware independent kernel modules for the build
+# machine, with the stubs in host/, and runs their benchmarks (host/hostbench.c)
+HOST_CC ?= gcc
+HOST_DIR = host/
+HOST_BUILDDIR = build/host/
+HOST_BENCH = $(HOST_BUILDDIR)hostbench
+HOST_TELEMRX = $(HOST_BUILDDIR)telemrx
+HOST_CC_FLAGS = -std=c99 -Wall -Wextra -Werror -g -O2
+
+HOST_SOURCES = $(addprefix $(SRCDIR)kernel/, \
+	memory.c pcb_turnstile.c semaphore.c mailbox.c msgq.c pipe.c usb_desc.c \
+	telemetry_frame.c bcm2835/usb_dwc2_fifos.c) \
+	$(wildcard $(HOST_DIR)*.c)
+
+host: $(HOST_BENCH)
+	$(PRINTF) "%-13s <%s>...\n" "Running" "$(notdir $<)"
+	$(HIDE)$(HOST_BENCH)
+
+$(HOST_BENCH): $(HOST_SOURCES) $(THIS)
+	$(MKDIR) $(HOST_BUILDDIR)
+	$(MKDIR) $(MISCDIR)
+	$(PRINTF) "$(COLOR_CC)%-13s$(COLOR_END) %-30s" "Compiling" "<$(notdir $@)>..."
+	$(HIDE)$(HOST_CC) $(HOST_CC_FLAGS) -o $@ $(HOST_SOURCES) \
+	$(call errorHandler,$@,$<,build,cc)
+
+# "make telemrx" builds the telemetry receiver (see host/telemrx/telemrx.c)
+telemrx: $(HOST_TELEMRX)
+
+$(HOST_TELEMRX): $(HOST_DIR)telemrx/telemrx.c $(SRCDIR)kernel/telemetry_frame.c $(THIS)
+	$(MKDIR) $(HOST_BUILDDIR)
+	$(MKDIR) $(MISCDIR)
+	$(PRINTF) "$(COLOR_CC)%-13s$(COLOR_END) %-30s" "Compiling" "<$(notdir $@)>..."
+	$(HIDE)$(HOST_CC) $(HOST_CC_FLAGS) -o $@ $(HOST_DIR)telemrx/telemrx.c \
+	$(SRCDIR)kernel/telemetry_frame.c \
+	$(call errorHandler,$@,$<,build,cc)
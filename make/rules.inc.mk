@@ -52,5 +52,5 @@ $(PRE): $(PREDIR)%.i: $$(shell find $(SRCDIR) -name '%.c') $(THIS)
 	$(MKDIR) $(DEPDIR)
 	$(MKDIR) $(MISCDIR)
 	$(PRINTF) "$(COLOR_PRE)%-13s$(COLOR_END) %-30s" "Preprocessing" "<$(notdir $<)>..."
-	$(CMD_PREFIX)gcc -E -o $@ -MMD -MT $@ -MF $(addprefix $(DEPDIR), $(notdir $(<:.c=.d))) $< \
+	$(CMD_PREFIX)gcc -E $(PP_FLAGS) -o $@ -MMD -MT $@ -MF $(addprefix $(DEPDIR), $(notdir $(<:.c=.d))) $< \
 	$(call errorHandler,$@,$<,build,pre)
@@ -52,3 +52,23 @@ deploy sdcopy umount:
 endif
 
 ubootscript: $(UBOOTSCRIPT)
+
+ifneq ($(BENCH),)
+# Headless run, with a kernel which stops QEMU when done (own build directory).
+# EXPERIMENTAL: the runner has only been tested with a fake QEMU so far, and
+# timings only fail the run with BENCH_TIMING=1, see bench.sh.
+bench:
+	$(HIDE)$(MAKE) --no-print-directory BENCH_EXIT=1 bench-run
+
+bench-baseline:
+	$(HIDE)$(MAKE) --no-print-directory BENCH_EXIT=1 BENCH_UPDATE=1 bench-run
+
+bench-run: $(KERNELELF)
+	$(PRINTF) "%-13s <%s>...\n" "Benchmarking" "$(BENCH)"
+	$(HIDE)BENCH_UPDATE=$(BENCH_UPDATE) BENCH_TIMING=$(BENCH_TIMING) ./bench.sh $(BENCH) $(MISCDIR) \
+		$(BENCH_BASELINEDIR)$(BENCH).json $(BENCH_TOLERANCE) $(BENCH_TIMEOUT) \
+		-- $(QEMU) $(QEMU_BENCH_FLAGS)
+else
+bench bench-baseline bench-run:
+	$(error "Please set BENCH variable!")
+endif
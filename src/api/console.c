@@ -0,0 +1,33 @@
+#include "console.h"
+#include "../kernel/bcm2835/uart.h"
+#include "../kernel/telemetry.h"
+
+void api_console_print ( const char * str )
+{
+	printu ( str );
+}
+
+void api_console_println ( const char * str )
+{
+	printuln ( str );
+}
+
+void api_console_print_dec ( uint32_t val )
+{
+	printu_32d ( val );
+}
+
+void api_console_print_hex ( uint32_t val )
+{
+	printu_32h ( val );
+}
+
+int api_console_write ( const void * buf, uint32_t n )
+{
+	return uart_write_dma ( buf, n );
+}
+
+int api_console_send_frame ( uint8_t channel, const void * data, uint32_t n )
+{
+	return telemetry_send ( channel, data, n );
+}
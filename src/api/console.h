@@ -0,0 +1,29 @@
+#ifndef _H_API_CONSOLE
+#define _H_API_CONSOLE
+
+#include <stdint.h>
+
+/*
+ * Prints on the system console (UART).
+ * Lines of concurrent processes may interleave.
+ */
+void api_console_print ( const char * str );
+void api_console_println ( const char * str );
+void api_console_print_dec ( uint32_t val );
+void api_console_print_hex ( uint32_t val );
+
+/*
+ * Sends n raw bytes on the console, by DMA: the caller sleeps meanwhile.
+ * Meant for bulk output (traces, dumps).
+ * @return n.
+ */
+int api_console_write ( const void * buf, uint32_t n );
+
+/*
+ * Sends n bytes (at most 256) as a binary telemetry frame on channel, for
+ * the host receiver (see kernel/telemetry.h). Waits for room on the UART.
+ * @return 0 on success, -1 if the payload is too large.
+ */
+int api_console_send_frame ( uint8_t channel, const void * data, uint32_t n );
+
+#endif
@@ -0,0 +1,17 @@
+#include "dma_copy.h"
+#include "../kernel/bcm2835/dma.h"
+
+int api_dma_copy ( void * dst, const void * src, uint32_t n, int sem )
+{
+	return dma_memcpy ( dst, src, n, dma_done_signal, DMA_SEM ( sem ) );
+}
+
+int api_dma_fill ( void * dst, uint8_t c, uint32_t n, int sem )
+{
+	return dma_memset ( dst, c, n, dma_done_signal, DMA_SEM ( sem ) );
+}
+
+uint32_t api_dma_errors ( )
+{
+	return dma_get_errors ( );
+}
@@ -0,0 +1,19 @@
+#ifndef _H_API_DMA_COPY
+#define _H_API_DMA_COPY
+
+#include <stdint.h>
+
+/*
+ * Copies offloaded to the DMA engine, see kernel/bcm2835/dma.h. The
+ * semaphore (from api_sem_create) is signaled once the transfer is over:
+ * buffers must not be touched until then. A failed transfer is signaled too:
+ * api_dma_errors counts them.
+ * @return 0 if the transfer is queued, -1 otherwise (nothing is signaled).
+ */
+int api_dma_copy ( void * dst, const void * src, uint32_t n, int sem );
+int api_dma_fill ( void * dst, uint8_t c, uint32_t n, int sem );
+
+// @return the number of failed transfers since boot
+uint32_t api_dma_errors ( );
+
+#endif
@@ -0,0 +1,31 @@
+#include "heap.h"
+#include "../kernel/memory.h"
+
+void * api_heap_allocate ( uint32_t size )
+{
+	return memory_allocate ( size );
+}
+
+void api_heap_free ( void * address )
+{
+	memory_deallocate ( address );
+}
+
+void api_heap_get_stats ( struct api_heap_stats * stats )
+{
+	struct memory_stats ms;
+	memory_get_stats ( &ms );
+
+	stats -> used_blocks = ms.used_blocks;
+	stats -> used_bytes = ms.used_bytes;
+	stats -> free_bytes = ms.free_bytes;
+	stats -> largest_free = ms.largest_free;
+	stats -> free_holes = ms.free_holes;
+	stats -> worst_irqoff_cycles = ms.worst_irqoff_cycles;
+	stats -> worst_irqoff_us = ms.worst_irqoff_us;
+}
+
+void api_heap_reset_stats ( )
+{
+	memory_reset_stats ( );
+}
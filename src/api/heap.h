@@ -0,0 +1,26 @@
+#ifndef _H_API_HEAP
+#define _H_API_HEAP
+
+#include <stdint.h>
+
+/*
+ * Kernel heap, see kernel/memory.h.
+ */
+void * api_heap_allocate ( uint32_t size );
+void api_heap_free ( void * address );
+
+struct api_heap_stats
+{
+	uint32_t used_blocks;
+	uint32_t used_bytes;
+	uint32_t free_bytes;
+	uint32_t largest_free;
+	uint32_t free_holes;
+	uint32_t worst_irqoff_cycles;
+	uint32_t worst_irqoff_us;
+};
+
+void api_heap_get_stats ( struct api_heap_stats * stats );
+void api_heap_reset_stats ( );
+
+#endif
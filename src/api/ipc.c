@@ -0,0 +1,48 @@
+#include "ipc.h"
+#include "../kernel/semaphore.h"
+#include "../kernel/mailbox.h"
+
+int api_sem_create ( int count )
+{
+	return sem_create ( count );
+}
+
+void api_sem_destroy ( int sem )
+{
+	sem_destroy ( sem );
+}
+
+int api_sem_wait ( int sem )
+{
+	return wait ( sem );
+}
+
+int api_sem_signal ( int sem )
+{
+	return signal ( sem );
+}
+
+int api_sem_wait_timeout ( int sem, uint32_t timeout )
+{
+	return wait_timeout ( sem, timeout );
+}
+
+int api_mailbox_create ( uint32_t capacity )
+{
+	return mailbox_create ( capacity );
+}
+
+void api_mailbox_destroy ( int mbox )
+{
+	mailbox_destroy ( mbox );
+}
+
+int api_mailbox_send ( int mbox, int msg )
+{
+	return mailbox_send ( mbox, msg );
+}
+
+int api_mailbox_recv ( int mbox )
+{
+	return mailbox_recv ( mbox );
+}
@@ -0,0 +1,23 @@
+#ifndef _H_API_IPC
+#define _H_API_IPC
+
+#include <stdint.h>
+
+/*
+ * Semaphores and mailboxes, see kernel/semaphore.h and kernel/mailbox.h.
+ * Handles are -1 on creation failure.
+ */
+int api_sem_create ( int count );
+void api_sem_destroy ( int sem );
+int api_sem_wait ( int sem );
+int api_sem_signal ( int sem );
+
+// Gives up after timeout microseconds: @return -1 then
+int api_sem_wait_timeout ( int sem, uint32_t timeout );
+
+int api_mailbox_create ( uint32_t capacity );
+void api_mailbox_destroy ( int mbox );
+int api_mailbox_send ( int mbox, int msg );
+int api_mailbox_recv ( int mbox );
+
+#endif
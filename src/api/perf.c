@@ -0,0 +1,23 @@
+#include "perf.h"
+#include "../kernel/pmu.h"
+#include "../kernel/scheduler.h"
+
+int api_perf_start ( uint32_t event0, uint32_t event1 )
+{
+	return pmu_start ( event0, event1 );
+}
+
+void api_perf_stop ( )
+{
+	pmu_stop ( );
+}
+
+void api_perf_read ( struct api_perf_counts * counts )
+{
+	struct pmu_counts pmu;
+	pmu_read ( pcb_running, &pmu );
+
+	counts -> cycles = pmu.cycles;
+	counts -> event0 = pmu.event0;
+	counts -> event1 = pmu.event1;
+}
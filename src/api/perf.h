@@ -0,0 +1,28 @@
+#ifndef _H_API_PERF
+#define _H_API_PERF
+
+#include <stdint.h>
+
+/*
+ * Performance counters, see kernel/pmu.h: CPU cycles and two events, counted
+ * for each process separately. Event numbers are the PMU_EVENT_* of
+ * kernel/pmu.h.
+ */
+struct api_perf_counts
+{
+	uint64_t cycles;
+	uint64_t event0;
+	uint64_t event1;
+};
+
+/*
+ * Counts event0 and event1 from now on, from 0, in every process.
+ * @return 0 on success, -1 on invalid event.
+ */
+int api_perf_start ( uint32_t event0, uint32_t event1 );
+void api_perf_stop ( );
+
+// Counts of the calling process since api_perf_start
+void api_perf_read ( struct api_perf_counts * counts );
+
+#endif
@@ -1,6 +1,7 @@
 #include "../kernel/pcb.h"
 #include "../kernel/arm.h"
 #include "../kernel/scheduler.h"
+#include "../kernel/bcm2835/systimer.h"
 
 void api_process_create ( void * f, void * args )
 {
@@ -15,3 +16,32 @@ void api_process_sleep ( uint32_t duration )
 	pcb_sleep ( pcb_running, duration );
 	irq_restore ( irqmask );
 }
+
+void api_process_sleep_until ( uint32_t date )
+{
+	uint32_t irqmask = irq_disable ( );
+	pcb_sleep_until ( pcb_running, date );
+	irq_restore ( irqmask );
+}
+
+void api_process_yield ( )
+{
+	uint32_t irqmask = irq_disable ( );
+	scheduler_yield ( );
+	irq_restore ( irqmask );
+}
+
+void api_process_msleep ( uint32_t msec )
+{
+	api_process_sleep ( msec * 1000 );
+}
+
+uint32_t api_process_get_clock ( )
+{
+	return systimer_get_clock ( );
+}
+
+uint32_t api_process_get_cycles ( )
+{
+	return arm_get_cycle_count ( );
+}
@@ -16,4 +16,27 @@ void api_process_create ( void * f, void * args );
  */
 void api_process_sleep ( uint32_t duration );
 
+/*
+ * Gives the CPU to other processes until the system timer reaches date
+ * (microseconds, see api_process_get_clock). Sleeping until a series of
+ * absolute dates gives a period free of drift.
+ */
+void api_process_sleep_until ( uint32_t date );
+
+/*
+ * Gives the CPU to the next ready process, if any.
+ */
+void api_process_yield ( );
+
+// Current system timer value, in microseconds
+uint32_t api_process_get_clock ( );
+
+// Current CPU cycle counter value. It wraps around, use differences only.
+uint32_t api_process_get_cycles ( );
+
+/*
+ * Same as api_process_sleep, with a duration in milliseconds.
+ */
+void api_process_msleep ( uint32_t msec );
+
 #endif
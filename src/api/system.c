@@ -0,0 +1,29 @@
+#include "system.h"
+#include "../kernel/bcm2835/watchdog.h"
+#include "../kernel/bcm2835/uart.h"
+#include "../kernel/arm.h"
+#include "../kernel/icache.h"
+
+void api_system_reset ( )
+{
+	irq_disable ( );
+
+	// Let pending output out first
+	uart_flush ( );
+
+	// Shortest timeout: 1/65536 second
+	watchdog_start ( 1 );
+
+	for ( ; ; );
+}
+
+uint32_t api_system_icache_lock ( int lock )
+{
+	if ( ! lock )
+	{
+		icache_unlock ( );
+		return 0;
+	}
+
+	return icache_lock_hot ( );
+}
@@ -0,0 +1,19 @@
+#ifndef _H_API_SYSTEM
+#define _H_API_SYSTEM
+
+#include <stdint.h>
+
+/*
+ * Resets the whole board (through the watchdog). Doesn't return.
+ * Under QEMU with -no-reboot, this makes QEMU exit.
+ */
+void api_system_reset ( );
+
+/*
+ * Locks the IRQ path into the I-cache (lock != 0), or gives its way back to
+ * the normal replacement, see kernel/icache.h. Locked at boot by default.
+ * @return the number of bytes locked, 0 once unlocked.
+ */
+uint32_t api_system_icache_lock ( int lock );
+
+#endif
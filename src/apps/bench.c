@@ -0,0 +1,187 @@
+#include "bench.h"
+#include "../api/console.h"
+#include "../api/process.h"
+#include "../api/system.h"
+
+void bench_begin ( const char * bench )
+{
+    api_console_print ( "BENCH " );
+    api_console_print ( bench );
+}
+
+void bench_value ( const char * key, uint32_t val )
+{
+    api_console_print ( " " );
+    api_console_print ( key );
+    api_console_print ( "=" );
+    api_console_print_dec ( val );
+}
+
+void bench_string ( const char * key, const char * str )
+{
+    api_console_print ( " " );
+    api_console_print ( key );
+    api_console_print ( "=" );
+    api_console_print ( str );
+}
+
+void bench_end ( )
+{
+    api_console_println ( 0 );
+}
+
+void bench_done ( const char * bench )
+{
+    bench_begin ( bench );
+    api_console_println ( " done" );
+
+#ifdef BENCH_EXIT
+    // Headless run (make bench): stop QEMU
+    api_system_reset ( );
+#endif
+}
+
+void bench_stats_init ( struct bench_stats * stats )
+{
+    stats -> count = 0;
+    stats -> min = ~0;
+    stats -> max = 0;
+    stats -> sum = 0;
+
+    for ( int i = 0 ; i < BENCH_HIST_BUCKETS ; ++i )
+    {
+        stats -> hist [ i ] = 0;
+    }
+}
+
+void bench_stats_add ( struct bench_stats * stats, uint32_t sample )
+{
+    stats -> count++;
+    stats -> sum += sample;
+
+    if ( sample < stats -> min )
+    {
+        stats -> min = sample;
+    }
+
+    if ( sample > stats -> max )
+    {
+        stats -> max = sample;
+    }
+
+    // Number of significant bits
+    uint32_t bucket = sample ? 32 - __builtin_clz ( sample ) : 0;
+    if ( bucket >= BENCH_HIST_BUCKETS )
+    {
+        bucket = BENCH_HIST_BUCKETS - 1;
+    }
+
+    stats -> hist [ bucket ]++;
+}
+
+void bench_stats_values ( struct bench_stats * stats )
+{
+    bench_value ( "count", stats -> count );
+
+    if ( stats -> count == 0 )
+    {
+        return;
+    }
+
+    bench_value ( "min", stats -> min );
+    bench_value ( "avg", stats -> sum / stats -> count );
+    bench_value ( "max", stats -> max );
+}
+
+void bench_stats_hist ( struct bench_stats * stats )
+{
+    for ( int i = 0 ; i < BENCH_HIST_BUCKETS ; ++i )
+    {
+        if ( stats -> hist [ i ] == 0 )
+        {
+            continue;
+        }
+
+        api_console_print ( " hist_" );
+        api_console_print_dec ( 1 << i );
+        api_console_print ( "=" );
+        api_console_print_dec ( stats -> hist [ i ] );
+    }
+}
+
+// Shell sort: no recursion, no allocation
+static void bench_sort ( uint32_t * samples, uint32_t n )
+{
+    for ( uint32_t gap = n / 2 ; gap > 0 ; gap /= 2 )
+    {
+        for ( uint32_t i = gap ; i < n ; ++i )
+        {
+            uint32_t val = samples [ i ];
+            uint32_t j = i;
+
+            for ( ; j >= gap && samples [ j - gap ] > val ; j -= gap )
+            {
+                samples [ j ] = samples [ j - gap ];
+            }
+
+            samples [ j ] = val;
+        }
+    }
+}
+
+void bench_percentiles ( uint32_t * samples, uint32_t n )
+{
+    if ( n == 0 )
+    {
+        return;
+    }
+
+    bench_sort ( samples, n );
+
+    bench_value ( "p50", samples [ ( n * 50 ) / 100 ] );
+    bench_value ( "p90", samples [ ( n * 90 ) / 100 ] );
+    bench_value ( "p99", samples [ ( n * 99 ) / 100 ] );
+    bench_value ( "p999", samples [ ( n * 999 ) / 1000 ] );
+    bench_value ( "max", samples [ n - 1 ] );
+}
+
+uint32_t bench_random ( uint32_t * state )
+{
+    uint32_t x = * state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    * state = x;
+    return x;
+}
+
+void bench_time_start ( struct bench_time * time )
+{
+    time -> us = api_process_get_clock ( );
+    time -> cycles = api_process_get_cycles ( );
+}
+
+void bench_time_stop ( struct bench_time * time )
+{
+    uint32_t cycles = api_process_get_cycles ( );
+    uint32_t us = api_process_get_clock ( );
+
+    time -> us = us - time -> us;
+    time -> cycles = cycles - time -> cycles;
+}
+
+void bench_time_values ( struct bench_time * time, uint32_t ops )
+{
+    bench_value ( "ops", ops );
+    bench_value ( "us", time -> us );
+
+    if ( ops == 0 )
+    {
+        return;
+    }
+
+    bench_value ( "ns_per_op", ( ( uint64_t ) time -> us * 1000 ) / ops );
+    bench_value ( "cycles_per_op", time -> cycles / ops );
+}
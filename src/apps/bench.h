@@ -0,0 +1,86 @@
+#ifndef _H_APPS_BENCH
+#define _H_APPS_BENCH
+
+#include <stdint.h>
+
+/*
+ * Benchmarks are built in with "make BENCH=<name>": init then starts the
+ * benchmark instead of the usual applications. Results are printed on the
+ * console one per line, to be easily parsed:
+ *     BENCH <bench> <key>=<value> <key>=<value>...
+ * and the end of the run is marked by:
+ *     BENCH <bench> done
+ *
+ * "make bench BENCH=<name>" runs it headless in QEMU, which is stopped by a
+ * board reset once done (BENCH_EXIT), and compares the results against a
+ * baseline, see bench.sh.
+ */
+
+// Result lines
+void bench_begin ( const char * bench );
+void bench_value ( const char * key, uint32_t val );
+void bench_string ( const char * key, const char * str );
+void bench_end ( );
+
+void bench_done ( const char * bench );
+
+/*
+ * Statistics over a series of samples (microseconds, cycles...), with a
+ * log2 histogram: bucket 0 counts samples equal to 0, bucket i samples in
+ * [ 2^(i-1), 2^i ), the last bucket everything above.
+ */
+#define BENCH_HIST_BUCKETS 24
+
+struct bench_stats
+{
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t hist [ BENCH_HIST_BUCKETS ];
+};
+
+void bench_stats_init ( struct bench_stats * stats );
+void bench_stats_add ( struct bench_stats * stats, uint32_t sample );
+
+// Adds count, min, avg and max to the current result line
+void bench_stats_values ( struct bench_stats * stats );
+
+// Adds the non-empty histogram buckets, as hist_<upper bound>=<count>
+void bench_stats_hist ( struct bench_stats * stats );
+
+/*
+ * Sorts samples, then adds p50, p90, p99, p999 and max to the result line.
+ */
+void bench_percentiles ( uint32_t * samples, uint32_t n );
+
+// Pseudo-random numbers (xorshift), state must not be 0
+uint32_t bench_random ( uint32_t * state );
+
+/*
+ * Elapsed time of a run, both in microseconds (system timer) and in CPU
+ * cycles. The cycle counter wraps around every few seconds: keep runs short.
+ */
+struct bench_time
+{
+    uint32_t us;
+    uint32_t cycles;
+};
+
+void bench_time_start ( struct bench_time * time );
+
+// time then holds the elapsed time since bench_time_start
+void bench_time_stop ( struct bench_time * time );
+
+// Adds ops, the total time, and the time per operation to the result line
+void bench_time_values ( struct bench_time * time, uint32_t ops );
+
+// Benchmarks
+void bench_latency ( );
+void bench_ipc ( );
+void bench_alloc ( );
+void bench_copy ( );
+void bench_checksum ( );
+void bench_icache ( );
+
+#endif
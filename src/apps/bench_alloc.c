@@ -0,0 +1,268 @@
+#include "bench.h"
+#include "../api/process.h"
+#include "../api/heap.h"
+
+/*
+ * Heap benchmark: keeps a set of live blocks, and replaces random ones with
+ * blocks of realistic sizes (USB requests, PCBs, buffers, process stacks).
+ * Reports allocation and de-allocation latency percentiles, fragmentation
+ * along the run and the worst IRQ-off section of the heap. Every block is
+ * finally freed in random order, and the heap must come back to its initial
+ * state.
+ *
+ * Latencies are measured per operation in CPU cycles, and per batch of
+ * operations with the system timer: the "<op>_batch" lines give percentiles
+ * of the nanoseconds per operation of each batch. Only the latter mean
+ * anything under QEMU, which reads the cycle counter as 0.
+ */
+
+#define BENCH_ALLOC_SLOTS 256
+#define BENCH_ALLOC_ROUNDS 4096
+#define BENCH_ALLOC_REPORT_PERIOD 512
+
+// Operations per system timer measurement (a 1 us resolution)
+#define BENCH_ALLOC_BATCH 64
+#define BENCH_ALLOC_BATCHES ( BENCH_ALLOC_ROUNDS / BENCH_ALLOC_BATCH )
+
+struct bench_alloc_class
+{
+    uint32_t weight;    // Out of 100
+    uint32_t min;
+    uint32_t max;
+};
+
+static const struct bench_alloc_class bench_alloc_classes [ ] =
+{
+    { 60, 48, 128 },                    // USB requests, descriptors
+    { 25, 28, 64 },                     // PCBs, small kernel objects
+    { 10, 512, 4096 },                  // Buffers
+    { 5, 256 * 1024, 256 * 1024 },      // Process stacks
+};
+
+#define BENCH_ALLOC_CLASSES \
+    ( sizeof ( bench_alloc_classes ) / sizeof ( bench_alloc_classes [ 0 ] ) )
+
+static void * bench_alloc_slots [ BENCH_ALLOC_SLOTS ];
+
+static uint32_t bench_alloc_samples [ BENCH_ALLOC_ROUNDS ];
+static uint32_t bench_free_samples [ BENCH_ALLOC_ROUNDS ];
+
+// Nanoseconds per operation, per batch
+static uint32_t bench_alloc_batch_ns [ BENCH_ALLOC_BATCHES ];
+static uint32_t bench_free_batch_ns [ BENCH_ALLOC_BATCHES ];
+
+static uint32_t bench_alloc_seed = 0x2545f491;
+static uint32_t bench_alloc_failures;
+
+static uint32_t bench_alloc_size ( )
+{
+    uint32_t pick = bench_random ( &bench_alloc_seed ) % 100;
+
+    for ( uint32_t i = 0 ; i < BENCH_ALLOC_CLASSES ; ++i )
+    {
+        const struct bench_alloc_class * c = & ( bench_alloc_classes [ i ] );
+
+        if ( pick < c -> weight )
+        {
+            return c -> min + bench_random ( &bench_alloc_seed ) % ( c -> max - c -> min + 1 );
+        }
+
+        pick -= c -> weight;
+    }
+
+    return bench_alloc_classes [ 0 ].min;
+}
+
+// @return the allocation time, in cycles
+static uint32_t bench_alloc_one ( uint32_t slot )
+{
+    uint32_t size = bench_alloc_size ( );
+
+    uint32_t start = api_process_get_cycles ( );
+    bench_alloc_slots [ slot ] = api_heap_allocate ( size );
+    uint32_t cycles = api_process_get_cycles ( ) - start;
+
+    if ( ! bench_alloc_slots [ slot ] )
+    {
+        bench_alloc_failures++;
+    }
+
+    return cycles;
+}
+
+// @return the de-allocation time, in cycles
+static uint32_t bench_free_one ( uint32_t slot )
+{
+    if ( ! bench_alloc_slots [ slot ] )
+    {
+        return 0;
+    }
+
+    uint32_t start = api_process_get_cycles ( );
+    api_heap_free ( bench_alloc_slots [ slot ] );
+    uint32_t cycles = api_process_get_cycles ( ) - start;
+
+    bench_alloc_slots [ slot ] = 0;
+
+    return cycles;
+}
+
+static void bench_alloc_report_heap ( const char * phase, uint32_t round )
+{
+    struct api_heap_stats stats;
+    api_heap_get_stats ( &stats );
+
+    bench_begin ( "alloc" );
+    bench_string ( "phase", phase );
+    bench_value ( "round", round );
+    bench_value ( "used_blocks", stats.used_blocks );
+    bench_value ( "used_bytes", stats.used_bytes );
+    bench_value ( "free_holes", stats.free_holes );
+    bench_value ( "largest_free", stats.largest_free );
+
+    // Free memory which is not part of the largest hole
+    bench_value ( "frag_bytes", stats.free_bytes - stats.largest_free );
+    bench_end ( );
+}
+
+// @return the nanoseconds per operation of a batch started at start (us)
+static uint32_t bench_alloc_batch_end ( uint32_t start, uint32_t ops )
+{
+    return ( api_process_get_clock ( ) - start ) * 1000 / ops;
+}
+
+/*
+ * Reports n per operation samples (cycles) and batches batch samples (ns per
+ * operation) of op
+ */
+static void bench_alloc_report_latency ( const char * op, const char * op_batch,
+        uint32_t * samples, uint32_t n, uint32_t * batch_ns, uint32_t batches )
+{
+    uint64_t sum = 0;
+
+    for ( uint32_t i = 0 ; i < batches ; ++i )
+    {
+        sum += batch_ns [ i ];
+    }
+
+    bench_begin ( "alloc" );
+    bench_string ( "op", op );
+    bench_value ( "count", n );
+    bench_value ( "ns_per_op", sum / batches );
+    bench_percentiles ( samples, n );
+    bench_end ( );
+
+    bench_begin ( "alloc" );
+    bench_string ( "op", op_batch );
+    bench_value ( "batch", n / batches );
+    bench_percentiles ( batch_ns, batches );
+    bench_end ( );
+}
+
+void bench_alloc ( )
+{
+    struct api_heap_stats initial;
+    struct api_heap_stats stats;
+
+    api_heap_get_stats ( &initial );
+    api_heap_reset_stats ( );
+    bench_alloc_failures = 0;
+
+    for ( uint32_t i = 0 ; i < BENCH_ALLOC_SLOTS ; ++i )
+    {
+        bench_alloc_one ( i );
+    }
+
+    bench_alloc_report_heap ( "fill", 0 );
+
+    /* Steady state: replace random blocks, a batch at a time. The slots of a
+     * batch are freed, then allocated again: they have to be distinct. */
+    uint32_t slots [ BENCH_ALLOC_BATCH ];
+
+    for ( uint32_t b = 0 ; b < BENCH_ALLOC_BATCHES ; ++b )
+    {
+        uint32_t first = b * BENCH_ALLOC_BATCH;
+        uint32_t base = bench_random ( &bench_alloc_seed );
+        uint32_t stride = bench_random ( &bench_alloc_seed ) | 1;
+
+        // Slots are a power of 2: an odd stride visits distinct ones
+        for ( uint32_t i = 0 ; i < BENCH_ALLOC_BATCH ; ++i )
+        {
+            slots [ i ] = ( base + i * stride ) % BENCH_ALLOC_SLOTS;
+        }
+
+        uint32_t start = api_process_get_clock ( );
+
+        for ( uint32_t i = 0 ; i < BENCH_ALLOC_BATCH ; ++i )
+        {
+            bench_free_samples [ first + i ] = bench_free_one ( slots [ i ] );
+        }
+
+        bench_free_batch_ns [ b ] = bench_alloc_batch_end ( start, BENCH_ALLOC_BATCH );
+        start = api_process_get_clock ( );
+
+        for ( uint32_t i = 0 ; i < BENCH_ALLOC_BATCH ; ++i )
+        {
+            bench_alloc_samples [ first + i ] = bench_alloc_one ( slots [ i ] );
+        }
+
+        bench_alloc_batch_ns [ b ] = bench_alloc_batch_end ( start, BENCH_ALLOC_BATCH );
+
+        if ( ( first + BENCH_ALLOC_BATCH ) % BENCH_ALLOC_REPORT_PERIOD == 0 )
+        {
+            bench_alloc_report_heap ( "churn", first + BENCH_ALLOC_BATCH );
+        }
+    }
+
+    bench_alloc_report_latency ( "allocate", "allocate_batch", bench_alloc_samples,
+            BENCH_ALLOC_ROUNDS, bench_alloc_batch_ns, BENCH_ALLOC_BATCHES );
+    bench_alloc_report_latency ( "deallocate", "deallocate_batch", bench_free_samples,
+            BENCH_ALLOC_ROUNDS, bench_free_batch_ns, BENCH_ALLOC_BATCHES );
+
+    // Free everything in random order (Fisher-Yates shuffle of the slots)
+    uint32_t order [ BENCH_ALLOC_SLOTS ];
+
+    for ( uint32_t i = 0 ; i < BENCH_ALLOC_SLOTS ; ++i )
+    {
+        order [ i ] = i;
+    }
+
+    for ( uint32_t i = BENCH_ALLOC_SLOTS - 1 ; i > 0 ; --i )
+    {
+        uint32_t j = bench_random ( &bench_alloc_seed ) % ( i + 1 );
+        uint32_t tmp = order [ i ];
+        order [ i ] = order [ j ];
+        order [ j ] = tmp;
+    }
+
+    uint32_t drain_batches = BENCH_ALLOC_SLOTS / BENCH_ALLOC_BATCH;
+
+    for ( uint32_t b = 0 ; b < drain_batches ; ++b )
+    {
+        uint32_t first = b * BENCH_ALLOC_BATCH;
+        uint32_t start = api_process_get_clock ( );
+
+        for ( uint32_t i = first ; i < first + BENCH_ALLOC_BATCH ; ++i )
+        {
+            bench_free_samples [ i ] = bench_free_one ( order [ i ] );
+        }
+
+        bench_free_batch_ns [ b ] = bench_alloc_batch_end ( start, BENCH_ALLOC_BATCH );
+    }
+
+    bench_alloc_report_latency ( "drain", "drain_batch", bench_free_samples,
+            BENCH_ALLOC_SLOTS, bench_free_batch_ns, drain_batches );
+
+    api_heap_get_stats ( &stats );
+
+    bench_begin ( "alloc" );
+    bench_value ( "failures", bench_alloc_failures );
+    bench_value ( "worst_irqoff_cycles", stats.worst_irqoff_cycles );
+    bench_value ( "worst_irqoff_us", stats.worst_irqoff_us );
+    bench_value ( "leak_blocks", stats.used_blocks - initial.used_blocks );
+    bench_value ( "ok", stats.used_blocks == initial.used_blocks
+            && stats.used_bytes == initial.used_bytes );
+    bench_end ( );
+
+    bench_done ( "alloc" );
+}
@@ -0,0 +1,217 @@
+#include "bench.h"
+#include "../api/heap.h"
+#include "../libc/checksum.h"
+
+/*
+ * Checksum throughput, per packet size: Internet checksum and CRC-32, each
+ * against a straightforward byte-at-a-time version. The byte versions are
+ * the reference: both implementations must agree on random data, at every
+ * alignment and length, in chunks, and on the published check values.
+ * "failures" must stay 0.
+ */
+
+#define BENCH_CHECKSUM_BYTES ( 256 * 1024 )
+#define BENCH_CHECKSUM_MAX 4096
+#define BENCH_CHECKSUM_ROUNDS 500
+
+// IP header, small packet, minimum IP MTU, Ethernet MTU, a page
+static const uint32_t bench_checksum_sizes [ ] = { 20, 64, 576, 1500, 4096 };
+
+#define BENCH_CHECKSUM_SIZES \
+    ( sizeof ( bench_checksum_sizes ) / sizeof ( bench_checksum_sizes [ 0 ] ) )
+
+static uint8_t * bench_checksum_buf;
+static uint32_t bench_checksum_seed = 0x1b873593;
+static uint32_t bench_checksum_failures;
+
+// RFC 1071, 16 bits at a time, in memory order like inet_checksum
+static uint16_t bench_checksum_inet_bytes ( const uint8_t * data, uint32_t n )
+{
+    uint32_t sum = 0;
+
+    for ( uint32_t i = 0 ; i + 1 < n ; i += 2 )
+    {
+        sum += ( data [ i ] << 8 ) | data [ i + 1 ];
+    }
+
+    if ( n & 1 )
+    {
+        sum += data [ n - 1 ] << 8;
+    }
+
+    while ( sum >> 16 )
+    {
+        sum = ( sum & 0xffff ) + ( sum >> 16 );
+    }
+
+    sum = ~sum & 0xffff;
+
+    return ( sum >> 8 ) | ( ( sum & 0xff ) << 8 );
+}
+
+// One bit at a time
+static uint32_t bench_checksum_crc32_bytes ( const uint8_t * data, uint32_t n )
+{
+    uint32_t crc = 0xffffffff;
+
+    for ( uint32_t i = 0 ; i < n ; ++i )
+    {
+        crc ^= data [ i ];
+
+        for ( int bit = 0 ; bit < 8 ; ++bit )
+        {
+            crc = ( crc & 1 ) ? ( crc >> 1 ) ^ 0xedb88320 : crc >> 1;
+        }
+    }
+
+    return ~crc;
+}
+
+static void bench_checksum_expect ( uint32_t got, uint32_t expected )
+{
+    if ( got != expected )
+    {
+        bench_checksum_failures++;
+    }
+}
+
+static void bench_checksum_verify ( )
+{
+    static const uint8_t rfc1071 [ ] = { 0x00, 0x01, 0xf2, 0x03, 0xf4, 0xf5, 0xf6, 0xf7 };
+    uint8_t * buf = bench_checksum_buf;
+
+    // Published values: ~0xddf2 stored big-endian, and the CRC-32 check
+    bench_checksum_expect ( inet_checksum ( rfc1071, 8 ), 0x0d22 );
+    bench_checksum_expect ( crc32 ( 0, "123456789", 9 ), 0xcbf43926 );
+
+    for ( uint32_t round = 0 ; round < BENCH_CHECKSUM_ROUNDS ; ++round )
+    {
+        uint32_t offset = bench_random ( &bench_checksum_seed ) % 8;
+        uint32_t n = bench_random ( &bench_checksum_seed ) % ( BENCH_CHECKSUM_MAX - 8 );
+        uint8_t * data = buf + offset;
+
+        // Some all-ones buffers, for the carries
+        uint32_t ones = round % 8 == 0;
+        for ( uint32_t i = 0 ; i < n ; ++i )
+        {
+            data [ i ] = ones ? 0xff : bench_random ( &bench_checksum_seed );
+        }
+
+        bench_checksum_expect ( inet_checksum ( data, n ),
+                bench_checksum_inet_bytes ( data, n ) );
+        bench_checksum_expect ( crc32 ( 0, data, n ),
+                bench_checksum_crc32_bytes ( data, n ) );
+
+        // In two chunks
+        uint32_t split = ( bench_random ( &bench_checksum_seed ) % ( n + 1 ) ) & ~1;
+        uint32_t sum = inet_checksum_partial ( data, split, 0 );
+        sum = inet_checksum_partial ( data + split, n - split, sum );
+        bench_checksum_expect ( inet_checksum_finish ( sum ),
+                bench_checksum_inet_bytes ( data, n ) );
+        bench_checksum_expect ( crc32 ( crc32 ( 0, data, split ), data + split, n - split ),
+                bench_checksum_crc32_bytes ( data, n ) );
+
+        // Over the data followed by its checksum, as in a header: 0
+        if ( ( n & 1 ) == 0 )
+        {
+            uint16_t check = inet_checksum ( data, n );
+            data [ n ] = check & 0xff;
+            data [ n + 1 ] = check >> 8;
+            bench_checksum_expect ( inet_checksum ( data, n + 2 ), 0 );
+        }
+    }
+}
+
+enum
+{
+    BENCH_CHECKSUM_INET,
+    BENCH_CHECKSUM_INET_BYTES,
+    BENCH_CHECKSUM_CRC32,
+    BENCH_CHECKSUM_CRC32_BYTES,
+    BENCH_CHECKSUM_TESTS,
+};
+
+static const char * const bench_checksum_names [ BENCH_CHECKSUM_TESTS ] =
+{
+    "inet", "inet_bytes", "crc32", "crc32_bytes",
+};
+
+static void bench_checksum_run ( int test, uint32_t size, uint32_t ops )
+{
+    const uint8_t * data = bench_checksum_buf;
+    uint32_t result = 0;
+
+    struct bench_time time;
+    bench_time_start ( &time );
+
+    for ( uint32_t i = 0 ; i < ops ; ++i )
+    {
+        switch ( test )
+        {
+            case BENCH_CHECKSUM_INET:
+                result ^= inet_checksum ( data, size );
+                break;
+            case BENCH_CHECKSUM_INET_BYTES:
+                result ^= bench_checksum_inet_bytes ( data, size );
+                break;
+            case BENCH_CHECKSUM_CRC32:
+                result ^= crc32 ( 0, data, size );
+                break;
+            case BENCH_CHECKSUM_CRC32_BYTES:
+                result ^= bench_checksum_crc32_bytes ( data, size );
+                break;
+        }
+    }
+
+    bench_time_stop ( &time );
+
+    bench_begin ( "checksum" );
+    bench_string ( "test", bench_checksum_names [ test ] );
+    bench_value ( "size", size );
+    bench_time_values ( &time, ops );
+    bench_value ( "mbps", time.us ? ( uint64_t ) size * ops / time.us : 0 );
+    bench_value ( "result", result );
+    bench_end ( );
+}
+
+void bench_checksum ( )
+{
+    bench_checksum_buf = api_heap_allocate ( BENCH_CHECKSUM_MAX );
+    bench_checksum_failures = 0;
+
+    if ( ! bench_checksum_buf )
+    {
+        bench_begin ( "checksum" );
+        bench_string ( "error", "allocation" );
+        bench_end ( );
+        bench_done ( "checksum" );
+        return;
+    }
+
+    bench_checksum_verify ( );
+
+    for ( uint32_t s = 0 ; s < BENCH_CHECKSUM_SIZES ; ++s )
+    {
+        uint32_t size = bench_checksum_sizes [ s ];
+
+        for ( int test = 0 ; test < BENCH_CHECKSUM_TESTS ; ++test )
+        {
+            // The bitwise CRC is slow: a tenth of the data will do
+            uint32_t bytes = BENCH_CHECKSUM_BYTES;
+            if ( test == BENCH_CHECKSUM_CRC32_BYTES )
+            {
+                bytes /= 10;
+            }
+
+            bench_checksum_run ( test, size, bytes / size + 1 );
+        }
+    }
+
+    api_heap_free ( bench_checksum_buf );
+
+    bench_begin ( "checksum" );
+    bench_value ( "failures", bench_checksum_failures );
+    bench_end ( );
+
+    bench_done ( "checksum" );
+}
@@ -0,0 +1,381 @@
+#include "bench.h"
+#include "../api/process.h"
+#include "../api/heap.h"
+#include "../api/ipc.h"
+#include "../api/dma_copy.h"
+#include "../libc/string.h"
+
+/*
+ * Memory functions throughput, per size class: memcpy (aligned, then from a
+ * misaligned source), memmove (overlapping, back and forth), memset and
+ * memcmp, against a byte-at-a-time copy as the reference, and against a DMA
+ * copy for the larger sizes. Every size class moves the same amount of data.
+ * Each result is checked byte by byte, including the bytes right after the
+ * destination.
+ *
+ * A check pass first compares every function against the byte-at-a-time
+ * references on random sizes, at every source and destination alignment,
+ * and memmove on overlaps at various distances, both ways. "failures" must
+ * stay 0.
+ */
+
+#define BENCH_COPY_BYTES ( 1024 * 1024 )
+#define BENCH_COPY_MAX 65536
+
+// Bytes after the destination which must be left alone
+#define BENCH_COPY_GUARD 8
+
+// The DMA engine is only worth it for large copies
+#define BENCH_COPY_DMA_MIN 1024
+
+// Check pass: sizes, mostly small, and memmove distances (past a 32 bytes block)
+#define BENCH_COPY_VERIFY_ROUNDS 64
+#define BENCH_COPY_VERIFY_SMALL 300
+#define BENCH_COPY_VERIFY_MAX 4096
+#define BENCH_COPY_VERIFY_SHIFT 40
+
+static const uint32_t bench_copy_sizes [ ] = { 16, 64, 256, 1024, 4096, 65536 };
+
+#define BENCH_COPY_SIZES \
+    ( sizeof ( bench_copy_sizes ) / sizeof ( bench_copy_sizes [ 0 ] ) )
+
+enum
+{
+    BENCH_COPY_BYTE_COPY,
+    BENCH_COPY_MEMCPY,
+    BENCH_COPY_MEMCPY_UNALIGNED,
+    BENCH_COPY_MEMMOVE,
+    BENCH_COPY_MEMSET,
+    BENCH_COPY_MEMCMP,
+    BENCH_COPY_DMA,
+    BENCH_COPY_TESTS,
+};
+
+static const char * const bench_copy_names [ BENCH_COPY_TESTS ] =
+{
+    "byte_copy", "memcpy", "memcpy_unaligned", "memmove", "memset", "memcmp",
+    "dma_copy",
+};
+
+static uint8_t * bench_copy_src;
+static uint8_t * bench_copy_dst;
+static uint32_t bench_copy_seed = 0x6c078965;
+static uint32_t bench_copy_failures;
+static int bench_copy_sem;
+
+// The former memcpy of src/libc, byte by byte
+static void bench_copy_bytes ( uint8_t * dst, const uint8_t * src, uint32_t n )
+{
+    for ( uint32_t i = 0 ; i < n ; ++i )
+    {
+        dst [ i ] = src [ i ];
+    }
+}
+
+// memmove, byte by byte
+static void bench_copy_move_bytes ( uint8_t * dst, const uint8_t * src, uint32_t n )
+{
+    if ( dst <= src )
+    {
+        bench_copy_bytes ( dst, src, n );
+        return;
+    }
+
+    for ( uint32_t i = n ; i > 0 ; --i )
+    {
+        dst [ i - 1 ] = src [ i - 1 ];
+    }
+}
+
+static void bench_copy_check ( const uint8_t * a, const uint8_t * b, uint32_t n )
+{
+    for ( uint32_t i = 0 ; i < n ; ++i )
+    {
+        if ( a [ i ] != b [ i ] )
+        {
+            bench_copy_failures++;
+            return;
+        }
+    }
+}
+
+static void bench_copy_fill ( uint8_t * buf, uint32_t n )
+{
+    for ( uint32_t i = 0 ; i < n ; ++i )
+    {
+        buf [ i ] = bench_random ( &bench_copy_seed );
+    }
+}
+
+static void bench_copy_expect ( int ok )
+{
+    if ( ! ok )
+    {
+        bench_copy_failures++;
+    }
+}
+
+static uint32_t bench_copy_verify_size ( uint32_t round )
+{
+    uint32_t max = round % 8 ? BENCH_COPY_VERIFY_SMALL : BENCH_COPY_VERIFY_MAX;
+
+    return bench_random ( &bench_copy_seed ) % ( max + 1 );
+}
+
+/*
+ * Checks the functions against the byte-at-a-time references. The results
+ * are written in the first half of dst, the expected bytes in the second
+ * half: both are compared including BENCH_COPY_GUARD bytes on each side.
+ */
+static void bench_copy_verify ( )
+{
+    uint8_t * src = bench_copy_src;
+    uint8_t * dst = bench_copy_dst;
+    uint8_t * expected = bench_copy_dst + BENCH_COPY_MAX / 2;
+
+    for ( uint32_t round = 0 ; round < BENCH_COPY_VERIFY_ROUNDS ; ++round )
+    {
+        // memcpy and memcmp, at every alignment pair
+        for ( uint32_t align = 0 ; align < 16 ; ++align )
+        {
+            uint32_t sa = align & 3;
+            uint32_t da = align >> 2;
+            uint32_t n = bench_copy_verify_size ( round );
+            uint32_t span = BENCH_COPY_GUARD + da + n + BENCH_COPY_GUARD;
+            uint8_t * d = dst + BENCH_COPY_GUARD + da;
+
+            bench_copy_fill ( src, sa + n );
+            bench_copy_fill ( dst, span );
+            bench_copy_bytes ( expected, dst, span );
+            bench_copy_bytes ( expected + BENCH_COPY_GUARD + da, src + sa, n );
+
+            bench_copy_expect ( memcpy ( d, src + sa, n ) == d );
+            bench_copy_check ( dst, expected, span );
+
+            // Equal, then one byte differs
+            bench_copy_expect ( memcmp ( d, src + sa, n ) == 0 );
+            if ( n )
+            {
+                uint32_t at = bench_random ( &bench_copy_seed ) % n;
+                d [ at ] = src [ sa + at ] ^ ( 1 << ( at & 7 ) );
+                int diff = memcmp ( d, src + sa, n );
+                bench_copy_expect ( diff != 0 &&
+                        ( diff > 0 ) == ( d [ at ] > src [ sa + at ] ) );
+            }
+        }
+
+        // memmove, both ways, aligned or not, from disjoint to fully overlapping
+        for ( uint32_t way = 0 ; way < 2 ; ++way )
+        {
+            uint32_t n = bench_copy_verify_size ( round );
+            uint32_t shift = bench_random ( &bench_copy_seed ) %
+                ( BENCH_COPY_VERIFY_SHIFT + 1 );
+            uint32_t base = bench_random ( &bench_copy_seed ) & 3;
+            uint32_t span = 2 * BENCH_COPY_GUARD + base + shift + n;
+            uint32_t from = BENCH_COPY_GUARD + base + ( way ? 0 : shift );
+            uint32_t to = BENCH_COPY_GUARD + base + ( way ? shift : 0 );
+
+            bench_copy_fill ( dst, span );
+            bench_copy_bytes ( expected, dst, span );
+            bench_copy_move_bytes ( expected + to, expected + from, n );
+
+            bench_copy_expect ( memmove ( dst + to, dst + from, n ) == dst + to );
+            bench_copy_check ( dst, expected, span );
+        }
+
+        // memset
+        {
+            uint32_t n = bench_copy_verify_size ( round );
+            uint32_t da = bench_random ( &bench_copy_seed ) & 3;
+            uint32_t span = BENCH_COPY_GUARD + da + n + BENCH_COPY_GUARD;
+            uint8_t c = bench_random ( &bench_copy_seed );
+            uint8_t * d = dst + BENCH_COPY_GUARD + da;
+
+            bench_copy_fill ( dst, span );
+            bench_copy_bytes ( expected, dst, span );
+            for ( uint32_t i = 0 ; i < n ; ++i )
+            {
+                expected [ BENCH_COPY_GUARD + da + i ] = c;
+            }
+
+            bench_copy_expect ( memset ( d, c, n ) == d );
+            bench_copy_check ( dst, expected, span );
+        }
+
+        // strlen, with non-zero bytes after the terminator
+        {
+            uint32_t n = bench_copy_verify_size ( round );
+            uint32_t sa = bench_random ( &bench_copy_seed ) & 3;
+
+            for ( uint32_t i = 0 ; i < sa + n + BENCH_COPY_GUARD ; ++i )
+            {
+                src [ i ] = ( bench_random ( &bench_copy_seed ) % 255 ) + 1;
+            }
+            src [ sa + n ] = 0;
+
+            bench_copy_expect ( strlen ( ( const char * ) src + sa ) == n );
+        }
+    }
+}
+
+// Runs the test ops times (an even number) on size bytes, then checks it
+static void bench_copy_run ( int test, uint32_t size, uint32_t ops )
+{
+    uint8_t * src = bench_copy_src;
+    uint8_t * dst = bench_copy_dst;
+    uint8_t guard [ BENCH_COPY_GUARD ];
+    int diff = 0;
+
+    bench_copy_fill ( src, size + 1 );
+    bench_copy_fill ( dst, size + 4 + BENCH_COPY_GUARD );
+
+    // memmove and memcmp work on a copy of the source
+    if ( test == BENCH_COPY_MEMMOVE || test == BENCH_COPY_MEMCMP )
+    {
+        bench_copy_bytes ( dst, src, size );
+    }
+
+    // memmove writes 4 bytes past size
+    uint32_t guard_at = size + ( test == BENCH_COPY_MEMMOVE ? 4 : 0 );
+    bench_copy_bytes ( guard, dst + guard_at, BENCH_COPY_GUARD );
+
+    struct bench_time time;
+    bench_time_start ( &time );
+
+    for ( uint32_t i = 0 ; i < ops ; ++i )
+    {
+        switch ( test )
+        {
+            case BENCH_COPY_BYTE_COPY:
+                bench_copy_bytes ( dst, src, size );
+                break;
+            case BENCH_COPY_MEMCPY:
+                memcpy ( dst, src, size );
+                break;
+            case BENCH_COPY_MEMCPY_UNALIGNED:
+                memcpy ( dst, src + 1, size );
+                break;
+            case BENCH_COPY_MEMMOVE:
+                // Up by 4 bytes, then back down: dst is back as it was
+                if ( i & 1 )
+                {
+                    memmove ( dst, dst + 4, size );
+                }
+                else
+                {
+                    memmove ( dst + 4, dst, size );
+                }
+                break;
+            case BENCH_COPY_MEMSET:
+                memset ( dst, 0x5a, size );
+                break;
+            case BENCH_COPY_MEMCMP:
+                diff |= memcmp ( dst, src, size );
+                break;
+            case BENCH_COPY_DMA:
+                if ( api_dma_copy ( dst, src, size, bench_copy_sem ) == 0 )
+                {
+                    api_sem_wait ( bench_copy_sem );
+                }
+                else
+                {
+                    bench_copy_failures++;
+                }
+                break;
+        }
+    }
+
+    bench_time_stop ( &time );
+
+    switch ( test )
+    {
+        case BENCH_COPY_MEMCPY_UNALIGNED:
+            bench_copy_check ( dst, src + 1, size );
+            break;
+        case BENCH_COPY_MEMSET:
+            for ( uint32_t i = 0 ; i < size ; ++i )
+            {
+                if ( dst [ i ] != 0x5a )
+                {
+                    bench_copy_failures++;
+                    break;
+                }
+            }
+            break;
+        case BENCH_COPY_MEMCMP:
+            // Equal so far, then the last byte differs
+            if ( diff )
+            {
+                bench_copy_failures++;
+            }
+            dst [ size - 1 ] = src [ size - 1 ] + 1;
+            diff = memcmp ( dst, src, size );
+            if ( diff == 0 || ( diff > 0 ) != ( dst [ size - 1 ] > src [ size - 1 ] ) )
+            {
+                bench_copy_failures++;
+            }
+            break;
+        default:
+            bench_copy_check ( dst, src, size );
+            break;
+    }
+
+    bench_copy_check ( guard, dst + guard_at, BENCH_COPY_GUARD );
+
+    bench_begin ( "copy" );
+    bench_string ( "test", bench_copy_names [ test ] );
+    bench_value ( "size", size );
+    bench_time_values ( &time, ops );
+    bench_value ( "mbps", time.us ? ( uint64_t ) size * ops / time.us : 0 );
+    bench_end ( );
+}
+
+void bench_copy ( )
+{
+    bench_copy_src = api_heap_allocate ( BENCH_COPY_MAX + 16 );
+    bench_copy_dst = api_heap_allocate ( BENCH_COPY_MAX + 16 );
+    bench_copy_sem = api_sem_create ( 0 );
+    bench_copy_failures = 0;
+
+    if ( ! bench_copy_src || ! bench_copy_dst || bench_copy_sem < 0 )
+    {
+        bench_begin ( "copy" );
+        bench_string ( "error", "allocation" );
+        bench_end ( );
+        bench_done ( "copy" );
+        return;
+    }
+
+    bench_copy_verify ( );
+
+    uint32_t dma_errors = api_dma_errors ( );
+
+    for ( uint32_t s = 0 ; s < BENCH_COPY_SIZES ; ++s )
+    {
+        uint32_t size = bench_copy_sizes [ s ];
+        uint32_t ops = BENCH_COPY_BYTES / size;
+
+        for ( int test = 0 ; test < BENCH_COPY_TESTS ; ++test )
+        {
+            if ( test == BENCH_COPY_DMA && size < BENCH_COPY_DMA_MIN )
+            {
+                continue;
+            }
+
+            bench_copy_run ( test, size, ops );
+        }
+    }
+
+    // Failed DMA transfers are signaled like the others
+    bench_copy_failures += api_dma_errors ( ) - dma_errors;
+
+    api_heap_free ( bench_copy_src );
+    api_heap_free ( bench_copy_dst );
+    api_sem_destroy ( bench_copy_sem );
+
+    bench_begin ( "copy" );
+    bench_value ( "failures", bench_copy_failures );
+    bench_end ( );
+
+    bench_done ( "copy" );
+}
@@ -0,0 +1,125 @@
+#include "bench.h"
+#include "../api/process.h"
+#include "../api/system.h"
+
+/*
+ * Cost of an interrupt with the IRQ path locked into the I-cache, and with
+ * the I-cache left to the normal replacement. Before each sample, 64 KB of
+ * code run through the cache, as drivers would between two interrupts. Then
+ * the process reads the cycle counter in a tight loop: a gap between two
+ * readings is the time an interrupt took away, from the exception entry to
+ * the return to the process (the scheduler tick, and any process it woke).
+ *
+ * Without a cycle counter (QEMU reads it as 0) there is nothing to measure:
+ * the benchmark reports error=no_cycle_counter instead.
+ */
+
+#define BENCH_ICACHE_SAMPLES 256
+
+// Two readings further apart than this (in cycles) are an interrupt
+#define BENCH_ICACHE_GAP 500
+
+// Evict again after that many cycles without interrupt
+#define BENCH_ICACHE_SPIN 200000
+
+// Give up waiting for an interrupt after that many microseconds
+#define BENCH_ICACHE_TIMEOUT 1000000
+
+extern void bench_icache_evict ( );
+
+static uint32_t bench_icache_samples [ BENCH_ICACHE_SAMPLES ];
+
+// @return 1 if the cycle counter advances over a millisecond, 0 otherwise
+static int bench_icache_has_cycles ( )
+{
+    uint32_t cycles = api_process_get_cycles ( );
+    uint32_t start = api_process_get_clock ( );
+
+    while ( api_process_get_clock ( ) - start < 1000 );
+
+    return api_process_get_cycles ( ) != cycles;
+}
+
+/*
+ * Waits for the next interrupt.
+ * @return the gap it made, in cycles, or 0 if none came before the timeout.
+ */
+static uint32_t bench_icache_gap ( )
+{
+    uint32_t begin = api_process_get_clock ( );
+
+    while ( api_process_get_clock ( ) - begin < BENCH_ICACHE_TIMEOUT )
+    {
+        bench_icache_evict ( );
+
+        uint32_t start = api_process_get_cycles ( );
+        uint32_t last = start;
+
+        while ( last - start < BENCH_ICACHE_SPIN )
+        {
+            uint32_t now = api_process_get_cycles ( );
+
+            if ( now - last > BENCH_ICACHE_GAP )
+            {
+                return now - last;
+            }
+
+            last = now;
+        }
+    }
+
+    return 0;
+}
+
+static void bench_icache_run ( int lock )
+{
+    struct bench_stats stats;
+    bench_stats_init ( &stats );
+
+    uint32_t locked = api_system_icache_lock ( lock );
+
+    for ( uint32_t i = 0 ; i < BENCH_ICACHE_SAMPLES ; ++i )
+    {
+        bench_icache_samples [ i ] = bench_icache_gap ( );
+
+        if ( ! bench_icache_samples [ i ] )
+        {
+            bench_begin ( "icache" );
+            bench_string ( "mode", lock ? "locked" : "unlocked" );
+            bench_string ( "error", "no_interrupt" );
+            bench_end ( );
+            return;
+        }
+
+        bench_stats_add ( &stats, bench_icache_samples [ i ] );
+    }
+
+    bench_begin ( "icache" );
+    bench_string ( "mode", lock ? "locked" : "unlocked" );
+    bench_value ( "hot_bytes", locked );
+    bench_value ( "min", stats.min );
+    bench_percentiles ( bench_icache_samples, BENCH_ICACHE_SAMPLES );
+    bench_end ( );
+
+    bench_begin ( "icache" );
+    bench_string ( "mode", lock ? "locked" : "unlocked" );
+    bench_stats_hist ( &stats );
+    bench_end ( );
+}
+
+void bench_icache ( )
+{
+    if ( ! bench_icache_has_cycles ( ) )
+    {
+        bench_begin ( "icache" );
+        bench_string ( "error", "no_cycle_counter" );
+        bench_end ( );
+        bench_done ( "icache" );
+        return;
+    }
+
+    bench_icache_run ( 0 );
+    bench_icache_run ( 1 );
+
+    bench_done ( "icache" );
+}
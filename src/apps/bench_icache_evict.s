@@ -0,0 +1,13 @@
+@ vim: ft=arm
+.syntax unified
+
+/* void bench_icache_evict ( )
+ * Runs through 64 KB of straight-line code, 4 times the size of the I-cache.
+ * Replacement is pseudo-random: a line survives the 16 linefills of its set
+ * about 1% of the time. Whatever was cached before is evicted, unless locked. */
+.globl bench_icache_evict
+bench_icache_evict:
+    .rept 16384
+    add r0, r0, #1
+    .endr
+    bx lr
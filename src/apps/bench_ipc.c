@@ -0,0 +1,256 @@
+#include "bench.h"
+#include "../api/process.h"
+#include "../api/ipc.h"
+
+/*
+ * Context switch and IPC micro-benchmarks:
+ * - yield: a process yielding alone, then two processes yielding to each other
+ * - sem: semaphore ping-pong between two processes
+ * - mailbox: producer/consumer throughput, for several mailbox capacities
+ * - spawn: process creation, then creation + run + exit
+ * - sem_timeout: a semaphore signaled after a waiter timed out, but before it
+ *   ran again, can be taken right away ("failures" must stay 0)
+ */
+
+#define BENCH_IPC_LOOPS 10000
+#define BENCH_IPC_SPAWN_LOOPS 200
+
+// Timeout of the waiter of sem_timeout (microseconds)
+#define BENCH_IPC_TIMEOUT 2000
+#define BENCH_IPC_TIMEOUT_MARGIN 200
+
+static const uint32_t bench_ipc_capacities [ ] = { 1, 4, 16, 64 };
+
+#define BENCH_IPC_CAPACITIES \
+    ( sizeof ( bench_ipc_capacities ) / sizeof ( bench_ipc_capacities [ 0 ] ) )
+
+// Signaled by the peer processes when they are done
+static int bench_ipc_done;
+
+static int bench_ipc_ping;
+static int bench_ipc_pong;
+static int bench_ipc_mbox;
+
+static void bench_ipc_report ( const char * test, uint32_t param,
+        struct bench_time * time, uint32_t ops )
+{
+    bench_begin ( "ipc" );
+    bench_string ( "test", test );
+    if ( param )
+    {
+        bench_value ( "param", param );
+    }
+    bench_time_values ( time, ops );
+    bench_end ( );
+}
+
+static void bench_ipc_yield_peer ( )
+{
+    for ( int i = 0 ; i < BENCH_IPC_LOOPS ; ++i )
+    {
+        api_process_yield ( );
+    }
+
+    api_sem_signal ( bench_ipc_done );
+}
+
+static void bench_ipc_yield ( )
+{
+    struct bench_time time;
+
+    // Nobody else to switch to (unless a driver thread is ready)
+    bench_time_start ( &time );
+    for ( int i = 0 ; i < BENCH_IPC_LOOPS ; ++i )
+    {
+        api_process_yield ( );
+    }
+    bench_time_stop ( &time );
+
+    bench_ipc_report ( "yield_solo", 0, &time, BENCH_IPC_LOOPS );
+
+    // Two processes yielding to each other: one switch per yield
+    api_process_create ( bench_ipc_yield_peer, 0 );
+
+    bench_time_start ( &time );
+    for ( int i = 0 ; i < BENCH_IPC_LOOPS ; ++i )
+    {
+        api_process_yield ( );
+    }
+    api_sem_wait ( bench_ipc_done );
+    bench_time_stop ( &time );
+
+    bench_ipc_report ( "yield_pair", 0, &time, 2 * BENCH_IPC_LOOPS );
+}
+
+static void bench_ipc_sem_peer ( )
+{
+    for ( int i = 0 ; i < BENCH_IPC_LOOPS ; ++i )
+    {
+        api_sem_wait ( bench_ipc_ping );
+        api_sem_signal ( bench_ipc_pong );
+    }
+
+    api_sem_signal ( bench_ipc_done );
+}
+
+static void bench_ipc_sem ( )
+{
+    struct bench_time time;
+
+    bench_ipc_ping = api_sem_create ( 0 );
+    bench_ipc_pong = api_sem_create ( 0 );
+
+    api_process_create ( bench_ipc_sem_peer, 0 );
+
+    // One round trip: ping the peer and wait for its pong
+    bench_time_start ( &time );
+    for ( int i = 0 ; i < BENCH_IPC_LOOPS ; ++i )
+    {
+        api_sem_signal ( bench_ipc_ping );
+        api_sem_wait ( bench_ipc_pong );
+    }
+    bench_time_stop ( &time );
+
+    api_sem_wait ( bench_ipc_done );
+
+    bench_ipc_report ( "sem_pingpong", 0, &time, BENCH_IPC_LOOPS );
+
+    api_sem_destroy ( bench_ipc_ping );
+    api_sem_destroy ( bench_ipc_pong );
+}
+
+static void bench_ipc_mailbox_consumer ( )
+{
+    for ( int i = 0 ; i < BENCH_IPC_LOOPS ; ++i )
+    {
+        api_mailbox_recv ( bench_ipc_mbox );
+    }
+
+    api_sem_signal ( bench_ipc_done );
+}
+
+static void bench_ipc_mailbox ( uint32_t capacity )
+{
+    struct bench_time time;
+
+    bench_ipc_mbox = api_mailbox_create ( capacity );
+    if ( bench_ipc_mbox < 0 )
+    {
+        return;
+    }
+
+    api_process_create ( bench_ipc_mailbox_consumer, 0 );
+
+    // Time until the consumer got every message
+    bench_time_start ( &time );
+    for ( int i = 0 ; i < BENCH_IPC_LOOPS ; ++i )
+    {
+        api_mailbox_send ( bench_ipc_mbox, i );
+    }
+    api_sem_wait ( bench_ipc_done );
+    bench_time_stop ( &time );
+
+    bench_ipc_report ( "mailbox", capacity, &time, BENCH_IPC_LOOPS );
+
+    api_mailbox_destroy ( bench_ipc_mbox );
+}
+
+static void bench_ipc_spawn_child ( )
+{
+    api_sem_signal ( bench_ipc_done );
+}
+
+static void bench_ipc_spawn ( )
+{
+    struct bench_time create;
+    struct bench_time total;
+    uint32_t create_us = 0;
+    uint32_t create_cycles = 0;
+
+    bench_time_start ( &total );
+    for ( int i = 0 ; i < BENCH_IPC_SPAWN_LOOPS ; ++i )
+    {
+        bench_time_start ( &create );
+        api_process_create ( bench_ipc_spawn_child, 0 );
+        bench_time_stop ( &create );
+
+        create_us += create.us;
+        create_cycles += create.cycles;
+
+        /* The child runs and signals, then exits right away: it keeps the
+         * CPU until then, we are only put back in the round robin */
+        api_sem_wait ( bench_ipc_done );
+    }
+    bench_time_stop ( &total );
+
+    create.us = create_us;
+    create.cycles = create_cycles;
+
+    bench_ipc_report ( "create", 0, &create, BENCH_IPC_SPAWN_LOOPS );
+    bench_ipc_report ( "create_exit", 0, &total, BENCH_IPC_SPAWN_LOOPS );
+}
+
+static int bench_ipc_timeout_sem;
+static volatile uint32_t bench_ipc_timeout_date;
+
+static void bench_ipc_timeout_waiter ( )
+{
+    bench_ipc_timeout_date = api_process_get_clock ( );
+    api_sem_wait_timeout ( bench_ipc_timeout_sem, BENCH_IPC_TIMEOUT );
+
+    api_sem_signal ( bench_ipc_done );
+}
+
+static void bench_ipc_sem_timeout ( )
+{
+    uint32_t failures = 0;
+
+    bench_ipc_timeout_sem = api_sem_create ( 0 );
+    bench_ipc_timeout_date = 0;
+
+    // Let the waiter block
+    api_process_create ( bench_ipc_timeout_waiter, 0 );
+    while ( ! bench_ipc_timeout_date )
+    {
+        api_process_yield ( );
+    }
+
+    /* Keep the CPU just past the timeout: the waiter is ready again, but
+     * only runs at the next tick */
+    while ( api_process_get_clock ( ) - bench_ipc_timeout_date
+            < BENCH_IPC_TIMEOUT + BENCH_IPC_TIMEOUT_MARGIN );
+
+    api_sem_signal ( bench_ipc_timeout_sem );
+    if ( api_sem_wait_timeout ( bench_ipc_timeout_sem, BENCH_IPC_TIMEOUT ) != 0 )
+    {
+        failures++;
+    }
+
+    api_sem_wait ( bench_ipc_done );
+    api_sem_destroy ( bench_ipc_timeout_sem );
+
+    bench_begin ( "ipc" );
+    bench_string ( "test", "sem_timeout" );
+    bench_value ( "failures", failures );
+    bench_end ( );
+}
+
+void bench_ipc ( )
+{
+    bench_ipc_done = api_sem_create ( 0 );
+
+    bench_ipc_yield ( );
+    bench_ipc_sem ( );
+
+    for ( uint32_t i = 0 ; i < BENCH_IPC_CAPACITIES ; ++i )
+    {
+        bench_ipc_mailbox ( bench_ipc_capacities [ i ] );
+    }
+
+    bench_ipc_spawn ( );
+    bench_ipc_sem_timeout ( );
+
+    api_sem_destroy ( bench_ipc_done );
+
+    bench_done ( "ipc" );
+}
@@ -0,0 +1,129 @@
+#include "bench.h"
+#include "../api/process.h"
+#include "../api/console.h"
+
+/*
+ * Wakeup latency benchmark (cyclictest-like): periodic threads sleep, and
+ * measure how late they actually wake up compared to the expected date.
+ * Odd threads sleep until absolute deadlines, even ones sleep for relative
+ * durations. A UART load generator runs meanwhile.
+ */
+
+#define BENCH_LATENCY_THREADS 4
+#define BENCH_LATENCY_LOOPS 1000
+
+// Load generator on/off
+#define BENCH_LATENCY_LOAD 1
+
+static const uint32_t bench_latency_periods [ BENCH_LATENCY_THREADS ] =
+{
+    1000, 1500, 2000, 5000,
+};
+
+struct bench_latency_thread
+{
+    uint32_t id;
+    uint32_t period;
+    int absolute;
+
+    struct bench_stats stats;
+    volatile int done;
+};
+
+static struct bench_latency_thread bench_latency_threads [ BENCH_LATENCY_THREADS ];
+
+static volatile int bench_latency_stop_load;
+
+static void bench_latency_measure ( struct bench_latency_thread * t )
+{
+    uint32_t next = api_process_get_clock ( );
+
+    for ( int i = 0 ; i < BENCH_LATENCY_LOOPS ; ++i )
+    {
+        uint32_t expected;
+
+        if ( t -> absolute )
+        {
+            next += t -> period;
+            expected = next;
+            api_process_sleep_until ( next );
+        }
+        else
+        {
+            expected = api_process_get_clock ( ) + t -> period;
+            api_process_sleep ( t -> period );
+        }
+
+        bench_stats_add ( & ( t -> stats ), api_process_get_clock ( ) - expected );
+    }
+
+    t -> done = 1;
+}
+
+// Keeps the CPU and the UART busy
+static void bench_latency_load ( )
+{
+    while ( ! bench_latency_stop_load )
+    {
+        api_console_println ( "load: 0123456789abcdefghijklmnopqrstuvwxyz" );
+    }
+}
+
+static void bench_latency_report ( struct bench_latency_thread * t )
+{
+    bench_begin ( "latency" );
+    bench_value ( "thread", t -> id );
+    bench_string ( "mode", t -> absolute ? "abs" : "rel" );
+    bench_value ( "period", t -> period );
+    bench_stats_values ( & ( t -> stats ) );
+    bench_end ( );
+
+    bench_begin ( "latency" );
+    bench_value ( "thread", t -> id );
+    bench_stats_hist ( & ( t -> stats ) );
+    bench_end ( );
+}
+
+void bench_latency ( )
+{
+    bench_latency_stop_load = 0;
+
+    if ( BENCH_LATENCY_LOAD )
+    {
+        api_process_create ( bench_latency_load, 0 );
+    }
+
+    for ( int i = 0 ; i < BENCH_LATENCY_THREADS ; ++i )
+    {
+        struct bench_latency_thread * t = & ( bench_latency_threads [ i ] );
+
+        t -> id = i;
+        t -> period = bench_latency_periods [ i ];
+        t -> absolute = i & 1;
+        t -> done = 0;
+        bench_stats_init ( & ( t -> stats ) );
+
+        api_process_create ( bench_latency_measure, t );
+    }
+
+    // Wait for all threads to complete
+    for ( int i = 0 ; i < BENCH_LATENCY_THREADS ; ++i )
+    {
+        while ( ! bench_latency_threads [ i ].done )
+        {
+            api_process_msleep ( 100 );
+        }
+    }
+
+    bench_latency_stop_load = 1;
+
+    // Let the load generator finish its line
+    api_process_msleep ( 10 );
+
+    for ( int i = 0 ; i < BENCH_LATENCY_THREADS ; ++i )
+    {
+        bench_latency_report ( & ( bench_latency_threads [ i ] ) );
+    }
+
+    bench_done ( "latency" );
+}
@@ -1,5 +1,6 @@
 #include "../api/process.h"
 #include "../api/led_morse.h"
+#include "bench.h"
 
 void morse ( )
 {
@@ -12,5 +13,19 @@ void morse ( )
 
 void init ( )
 {
+#if defined ( BENCH_LATENCY )
+    api_process_create ( bench_latency, 0 );
+#elif defined ( BENCH_IPC )
+    api_process_create ( bench_ipc, 0 );
+#elif defined ( BENCH_ALLOC )
+    api_process_create ( bench_alloc, 0 );
+#elif defined ( BENCH_COPY )
+    api_process_create ( bench_copy, 0 );
+#elif defined ( BENCH_CHECKSUM )
+    api_process_create ( bench_checksum, 0 );
+#elif defined ( BENCH_ICACHE )
+    api_process_create ( bench_icache, 0 );
+#else
 	api_process_create ( morse, 0 );
+#endif
 }
@@ -2,6 +2,7 @@
 #define _H_ARM
 
 #include <stdint.h>
+#include "config.h"
 
 #define ARM_MODE_USR 0x10
 #define ARM_MODE_FIQ 0x11
@@ -14,6 +15,7 @@
 #define ARM_MODE_MASK 0x1F
 
 #define ARM_CPSR_IRQ_MASK 0x80
+#define ARM_CPSR_FIQ_MASK 0x40
 
 // Wait a number of cycles
 void cdelay ( int cycles );
@@ -41,8 +43,49 @@ extern uint32_t irq_disable ( );
 // Restore a previously saved cpsr
 extern void irq_restore ( uint32_t cpsr );
 
+/*
+ * Disable both IRQ and FIQ and returns cpsr prior to deactivation.
+ * To be restored with irq_restore.
+ */
+extern uint32_t fiq_disable ( );
+
+#ifdef KERNEL_TRACE_IRQOFF
+#include "irqoff_trace.h"
+
+// Call "( irq_disable ) ( )" to bypass the tracer
+#define irq_disable() irqoff_trace_disable ( )
+#define irq_restore(cpsr) irqoff_trace_restore ( cpsr )
+#endif
+
 extern void dmb ( );
 
+/*
+ * Atomically replaces * ptr by new if it equals old (ldrex/strex).
+ * @return the previous value of * ptr: old on success.
+ */
+extern uint32_t atomic_cas ( volatile uint32_t * ptr, uint32_t old, uint32_t new );
+
+// Write the Performance Monitor Control Register (PMNC), see pmu.h
+extern void arm_pmu_set_control ( uint32_t pmnc );
+
+// Read the CPU cycle counter. It wraps around, use differences only.
+extern uint32_t arm_get_cycle_count ( );
+
+// Read the cycle counter, then both event counters, in a row
+extern void arm_pmu_read ( uint32_t counters [ 3 ] );
+
+// Invalidate, then enable the L1 instruction cache
+extern void arm_icache_enable ( );
+
+// Write the Instruction Cache Lockdown Register (a set bit locks a way)
+extern void arm_icache_set_lockdown ( uint32_t lockdown );
+
+/*
+ * Load [ start, end ) into an I-cache way, then lock the way. The range must
+ * fit in a way. See icache.h.
+ */
+extern void arm_icache_lock ( const void * start, const void * end, uint32_t way );
+
 extern void pause ( );
 extern void __attribute__ (( noreturn )) halt ( );
 
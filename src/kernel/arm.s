@@ -10,6 +10,10 @@ arm_get_cpsr:
     mrs r0, cpsr
     bx lr
 
+/* The IRQ path runs these: they are locked into the I-cache along with it,
+ * see icache.h */
+.section .text.hot, "ax", %progbits
+
 .globl irq_enable
 irq_enable:
     cpsie i
@@ -21,11 +25,19 @@ irq_disable:
     cpsid i
     bx lr
 
+.globl fiq_disable
+fiq_disable:
+    mrs r0, cpsr
+    cpsid if
+    bx lr
+
 .globl irq_restore
 irq_restore:
     msr cpsr_c, r0
     bx lr
 
+.text
+
 .globl cdelay
 cdelay:
     subs r0, r0, #1
@@ -38,6 +50,109 @@ dmb:
 	mcr	p15, 0, r0, c7, c10, 5
 	mov pc, lr
 
+/* Compare-and-swap: stores new at ptr if it holds old, atomically even against
+ * interrupt handlers. Returns the value found at ptr (old on success).
+ * The exclusive monitor is cleared on failure, so that an interrupted ldrex
+ * can't be paired with our strex. */
+.globl atomic_cas
+atomic_cas:
+    ldrex r3, [r0]
+    cmp r3, r1
+    bne 1f
+    strex r12, r2, [r0]
+    cmp r12, #0
+    bne atomic_cas
+    mov r0, r3
+    bx lr
+1:
+    clrex
+    mov r0, r3
+    bx lr
+
+/* The ARM1176 performance counters are driven by the Performance Monitor
+ * Control Register (PMNC, c15 c12 0), see pmu.c: the Cycle Counter Register
+ * (CCNT, c15 c12 1) and the Count Registers 0 and 1 (c15 c12 2 and 3). */
+.globl arm_pmu_set_control
+arm_pmu_set_control:
+    mcr p15, 0, r0, c15, c12, 0
+    bx lr
+
+.section .text.hot, "ax", %progbits
+
+.globl arm_get_cycle_count
+arm_get_cycle_count:
+    mrc p15, 0, r0, c15, c12, 1
+    bx lr
+
+@ void arm_pmu_read ( uint32_t counters [ 3 ] ): CCNT, then PMN0 and PMN1
+.globl arm_pmu_read
+arm_pmu_read:
+    mrc p15, 0, r1, c15, c12, 1
+    mrc p15, 0, r2, c15, c12, 2
+    mrc p15, 0, r3, c15, c12, 3
+    stmia r0, {r1-r3}
+    bx lr
+
+.text
+
+/* L1 instruction cache: enabled by bit 12 of the Control Register (c1 c0 0).
+ * Any line left by the bootloader is dropped first. */
+.globl arm_icache_enable
+arm_icache_enable:
+    mov r0, #0
+    mcr p15, 0, r0, c7, c5, 0
+    mrc p15, 0, r0, c1, c0, 0
+    orr r0, r0, #0x1000
+    mcr p15, 0, r0, c1, c0, 0
+    bx lr
+
+/* The Instruction Cache Lockdown Register (c9 c0 1) has one bit per way:
+ * linefills never go to the ways whose bit is set. Bits 31:4 should be one. */
+.globl arm_icache_set_lockdown
+arm_icache_set_lockdown:
+    mcr p15, 0, r0, c9, c0, 1
+    bx lr
+
+/* void arm_icache_lock ( const void * start, const void * end, uint32_t way )
+ * Loads the lines of [ start, end ) into way, then locks it: they stay
+ * there whatever runs next. The range must be no larger than a way.
+ * The cache is invalidated first, so that no line of the range is a hit in
+ * another way. Meanwhile every other way is locked, and interrupts are
+ * masked: all linefills go to way. This code is part of .text.hot, so that
+ * its own linefills are lines of the range too. */
+.section .text.hot, "ax", %progbits
+
+.globl arm_icache_lock
+arm_icache_lock:
+    mrs r12, cpsr
+    cpsid if
+
+    mov r3, #0
+    mcr p15, 0, r3, c7, c5, 0   @ Invalidate the I-cache
+    mcr p15, 0, r3, c7, c5, 6   @ and the branch target cache
+
+    mov r3, #1
+    lsl r3, r3, r2
+    mvn r2, r3
+    mcr p15, 0, r2, c9, c0, 1
+
+    @ Prefetch Instruction Cache Line, by address
+    bic r0, r0, #31
+1:
+    mcr p15, 0, r0, c7, c13, 1
+    add r0, r0, #32
+    cmp r0, r1
+    blo 1b
+
+    mvn r2, #0xf
+    orr r2, r2, r3
+    mcr p15, 0, r2, c9, c0, 1
+
+    msr cpsr_c, r12
+    bx lr
+
+.text
+
 /* Put the processor into a low power consumption mode until an interrupt
  * occurs. This could have been implemented using "wfi" instruction.
  * Unfortunately, "wfi" is not supported before ARMv7. On ARMv6, depending on
@@ -3,6 +3,7 @@
 
 #define PERI_BASE       0x20000000
 #define SYSTIMER_BASE   ( PERI_BASE + 0x3000 )
+#define DMA_BASE        ( PERI_BASE + 0x7000 )
 #define PIC_BASE        ( PERI_BASE + 0xB200 )
 #define MBOX_BASE       ( PERI_BASE + 0xB880 )
 #define WATCHDOG_BASE   ( PERI_BASE + 0x100000 )
@@ -10,5 +11,8 @@
 #define UART_BASE       ( PERI_BASE + 0x201000 )
 #define USB_HCD_BASE    ( PERI_BASE + 0x980000 )
 
+// Peripherals as seen by bus masters (DMA engine)
+#define PERI_BUS_BASE   0x7E000000
+
 
 #endif
@@ -0,0 +1,293 @@
+#include "dma.h"
+#include "bcm2835.h"
+
+#include "../arm.h"
+#include "../semaphore.h"
+#include "uart.h"
+
+#define DMA_CHANNEL_NB 16
+
+/* Channels left to us by the firmware. Channels 11 to 14 share a single IRQ,
+ * and channel 15 lives elsewhere: don't bother with them. */
+#define DMA_CHANNELS_FREE 0x0730
+#define DMA_CHANNELS_LITE 0x7f80
+
+// Asynchronous copies pending at most (power of 2)
+#define DMA_JOB_NB 16
+#define DMA_JOB_MASK ( DMA_JOB_NB - 1 )
+
+struct dma_channel_regs
+{
+    uint32_t cs;        // Control and Status
+    uint32_t conblk_ad; // Bus address of the current control block
+    uint32_t ti;        // Current control block, as loaded
+    uint32_t source_ad;
+    uint32_t dest_ad;
+    uint32_t txfr_len;
+    uint32_t stride;
+    uint32_t nextconbk;
+    uint32_t debug;
+    uint32_t reserved [ 55 ];   // Channels are 0x100 apart
+};
+
+// Control and Status
+#define DMA_CS_ACTIVE       ( 1 << 0 )
+#define DMA_CS_END          ( 1 << 1 )  // Write 1 to clear
+#define DMA_CS_INT          ( 1 << 2 )  // Write 1 to clear
+#define DMA_CS_ERROR        ( 1 << 8 )
+#define DMA_CS_PRIORITY(n)  ( ( n ) << 16 )
+#define DMA_CS_PANIC_PRIORITY(n) ( ( n ) << 20 )
+#define DMA_CS_WAIT_FOR_OUTSTANDING_WRITES ( 1 << 28 )
+#define DMA_CS_ABORT        ( 1 << 30 )
+#define DMA_CS_RESET        ( 1u << 31 )
+
+// Debug: errors are cleared by writing them back
+#define DMA_DEBUG_ERRORS    0x7
+
+#define DMA_ENABLE ( ( uint32_t volatile * ) ( DMA_BASE + 0xff0 ) )
+
+// Memory as seen from the bus, through the L2 cache (as the ARM sees it)
+#define DMA_BUS_MEMORY 0x40000000
+
+static volatile struct dma_channel_regs * dma_channels =
+    ( volatile struct dma_channel_regs * ) DMA_BASE;
+
+static uint32_t dma_channels_used;
+
+// An asynchronous copy, with its control block
+struct dma_job
+{
+    struct dma_cb cb;
+    uint32_t pattern;   // Source of memset
+    dma_done_t done;
+    void * ctx;
+};
+
+/* Copies are queued in a ring, and run from its tail one at a time: the
+ * completion interrupt starts the next one. */
+static struct dma_job dma_jobs [ DMA_JOB_NB ];
+static uint32_t dma_jobs_head;
+static uint32_t dma_jobs_tail;
+static int dma_memory_chan = -1;
+static uint32_t dma_errors;
+
+int dma_channel_alloc ( uint32_t flags, interrupt_handler_t handler,
+        void * ctx )
+{
+    uint32_t irqmask = irq_disable ( );
+    uint32_t candidates = DMA_CHANNELS_FREE & ~dma_channels_used;
+
+    if ( flags & DMA_CHANNEL_FULL )
+    {
+        candidates &= ~DMA_CHANNELS_LITE;
+    }
+    else if ( candidates & DMA_CHANNELS_LITE )
+    {
+        // Leave full channels to those who need them
+        candidates &= DMA_CHANNELS_LITE;
+    }
+
+    for ( int chan = 0 ; chan < DMA_CHANNEL_NB ; ++chan )
+    {
+        uint32_t bit = 1 << chan;
+
+        if ( ! ( candidates & bit ) )
+        {
+            continue;
+        }
+
+        dma_channels_used |= bit;
+        * DMA_ENABLE |= bit;
+        irq_restore ( irqmask );
+
+        dma_channels [ chan ].cs = DMA_CS_RESET;
+
+        pic_register_handler ( IRQ_DMA0 + chan, handler, ctx );
+        pic_enable_irq ( IRQ_DMA0 + chan );
+
+        return chan;
+    }
+
+    irq_restore ( irqmask );
+    return -1;
+}
+
+void dma_start ( int chan, const struct dma_cb * cb )
+{
+    volatile struct dma_channel_regs * regs = & ( dma_channels [ chan ] );
+
+    regs -> debug = DMA_DEBUG_ERRORS;
+    regs -> cs = DMA_CS_END | DMA_CS_INT;
+    regs -> conblk_ad = dma_bus_addr ( cb );
+
+    // Control blocks must be in memory before the engine fetches them
+    dmb ( );
+
+    regs -> cs = DMA_CS_ACTIVE | DMA_CS_WAIT_FOR_OUTSTANDING_WRITES |
+        DMA_CS_PRIORITY ( 8 ) | DMA_CS_PANIC_PRIORITY ( 8 );
+}
+
+int dma_busy ( int chan )
+{
+    return dma_channels [ chan ].cs & DMA_CS_ACTIVE;
+}
+
+int dma_ack ( int chan )
+{
+    int raised = dma_channels [ chan ].cs & DMA_CS_INT;
+    dma_channels [ chan ].cs = DMA_CS_INT;
+
+    return raised != 0;
+}
+
+static int dma_memory_interrupt ( void * ctx )
+{
+    ( void ) ctx;
+
+    uint32_t irqmask = irq_disable ( );
+
+    if ( ! dma_ack ( dma_memory_chan ) || dma_jobs_tail == dma_jobs_head )
+    {
+        irq_restore ( irqmask );
+        return PIC_HANDLED;
+    }
+
+    // The slot is reused as soon as the tail moves
+    struct dma_job * job = & ( dma_jobs [ dma_jobs_tail & DMA_JOB_MASK ] );
+    dma_done_t done = job -> done;
+    void * done_ctx = job -> ctx;
+    int status = 0;
+
+    // A read or write error stops the channel: start the next job afresh
+    volatile struct dma_channel_regs * regs = & ( dma_channels [ dma_memory_chan ] );
+    if ( ( regs -> cs & DMA_CS_ERROR ) || ( regs -> debug & DMA_DEBUG_ERRORS ) )
+    {
+        regs -> debug = DMA_DEBUG_ERRORS;
+        regs -> cs = DMA_CS_RESET;
+        dma_errors++;
+        status = -1;
+    }
+
+    dma_jobs_tail++;
+    if ( dma_jobs_tail != dma_jobs_head )
+    {
+        dma_start ( dma_memory_chan,
+                & ( dma_jobs [ dma_jobs_tail & DMA_JOB_MASK ].cb ) );
+    }
+
+    irq_restore ( irqmask );
+
+    if ( status != 0 )
+    {
+        printuln ( "DMA copy failed, channel reset" );
+    }
+
+    if ( done )
+    {
+        done ( done_ctx, status );
+    }
+
+    return PIC_RESCHEDULE;
+}
+
+/*
+ * Queues a copy to dst, from src (incremented) or from the pattern of the job
+ * (src null).
+ */
+static int dma_submit ( void * dst, const void * src, uint32_t pattern,
+        uint32_t n, dma_done_t done, void * ctx )
+{
+    if ( dma_memory_chan < 0 || n > DMA_MAX_LEN )
+    {
+        return -1;
+    }
+
+    uint32_t irqmask = irq_disable ( );
+
+    if ( dma_jobs_head - dma_jobs_tail == DMA_JOB_NB )
+    {
+        irq_restore ( irqmask );
+        return -1;
+    }
+
+    struct dma_job * job = & ( dma_jobs [ dma_jobs_head & DMA_JOB_MASK ] );
+    job -> done = done;
+    job -> ctx = ctx;
+    job -> pattern = pattern;
+
+    // 128 bits accesses need 16 bytes aligned buffers
+    uint32_t wide = ( ( uintptr_t ) dst | ( uintptr_t ) src | n ) & 0xf ?
+        0 : DMA_TI_DEST_WIDTH | DMA_TI_SRC_WIDTH;
+
+    job -> cb.ti = DMA_TI_INTEN | DMA_TI_WAIT_RESP | DMA_TI_DEST_INC |
+        DMA_TI_BURST_LENGTH ( 4 ) | ( wide & DMA_TI_DEST_WIDTH );
+    if ( src )
+    {
+        job -> cb.ti |= DMA_TI_SRC_INC | ( wide & DMA_TI_SRC_WIDTH );
+        job -> cb.source_ad = dma_bus_addr ( src );
+    }
+    else if ( pattern )
+    {
+        job -> cb.source_ad = dma_bus_addr ( & ( job -> pattern ) );
+    }
+    else
+    {
+        // Zeros come for free, without reading anything
+        job -> cb.ti |= DMA_TI_SRC_IGNORE;
+        job -> cb.source_ad = 0;
+    }
+    job -> cb.dest_ad = dma_bus_addr ( dst );
+    job -> cb.txfr_len = n;
+    job -> cb.stride = 0;
+    job -> cb.nextconbk = 0;
+
+    // Nothing in flight: start right away
+    if ( dma_jobs_head++ == dma_jobs_tail )
+    {
+        dma_start ( dma_memory_chan, & ( job -> cb ) );
+    }
+
+    irq_restore ( irqmask );
+    return 0;
+}
+
+int dma_memcpy ( void * dst, const void * src, uint32_t n, dma_done_t done,
+        void * ctx )
+{
+    return dma_submit ( dst, src, 0, n, done, ctx );
+}
+
+int dma_memset ( void * dst, uint8_t c, uint32_t n, dma_done_t done,
+        void * ctx )
+{
+    return dma_submit ( dst, 0, c * 0x01010101, n, done, ctx );
+}
+
+void dma_done_signal ( void * sem, int status )
+{
+    ( void ) status;
+    signal ( ( sem_t ) ( intptr_t ) sem );
+}
+
+uint32_t dma_get_errors ( )
+{
+    return dma_errors;
+}
+
+void dma_init ( )
+{
+    dma_jobs_head = 0;
+    dma_jobs_tail = 0;
+    dma_memory_chan = dma_channel_alloc ( DMA_CHANNEL_FULL,
+            dma_memory_interrupt, 0 );
+}
+
+uint32_t dma_bus_addr ( const volatile void * ptr )
+{
+    return ( uint32_t ) ptr | DMA_BUS_MEMORY;
+}
+
+uint32_t dma_peri_bus_addr ( uint32_t addr )
+{
+    return addr - PERI_BASE + PERI_BUS_BASE;
+}
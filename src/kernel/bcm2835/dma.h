@@ -0,0 +1,108 @@
+#ifndef _H_BCM2835_DMA
+#define _H_BCM2835_DMA
+
+#include <stdint.h>
+
+#include "pic.h"
+
+/*
+ * A transfer is described by a chain of control blocks, read by the DMA
+ * engine from memory. They must be 32 bytes aligned.
+ */
+struct dma_cb
+{
+    uint32_t ti;        // Transfer Information
+    uint32_t source_ad; // Source bus address
+    uint32_t dest_ad;   // Destination bus address
+    uint32_t txfr_len;  // Transfer length (in bytes)
+    uint32_t stride;    // 2D mode stride
+    uint32_t nextconbk; // Bus address of the next control block (0 to stop)
+    uint32_t reserved [ 2 ];
+} __attribute__ ( ( aligned ( 32 ) ) );
+
+// Transfer Information
+#define DMA_TI_INTEN            ( 1 << 0 )  // Interrupt when this CB is done
+#define DMA_TI_WAIT_RESP        ( 1 << 3 )  // Wait for write responses
+#define DMA_TI_DEST_INC         ( 1 << 4 )
+#define DMA_TI_DEST_WIDTH       ( 1 << 5 )  // 128 bits writes
+#define DMA_TI_DEST_DREQ        ( 1 << 6 )  // Writes paced by PERMAP
+#define DMA_TI_SRC_INC          ( 1 << 8 )
+#define DMA_TI_SRC_WIDTH        ( 1 << 9 )  // 128 bits reads
+#define DMA_TI_SRC_DREQ         ( 1 << 10 ) // Reads paced by PERMAP
+#define DMA_TI_SRC_IGNORE       ( 1 << 11 ) // Don't read, write zeros
+#define DMA_TI_BURST_LENGTH(n)  ( ( n ) << 12 )
+#define DMA_TI_PERMAP(n)        ( ( n ) << 16 )
+
+// Peripherals pacing transfers (PERMAP)
+#define DMA_DREQ_UART_TX    12
+
+// Transfers of full channels are at most 1 GB
+#define DMA_MAX_LEN         0x3ffffffc
+
+// Flags of dma_channel_alloc
+#define DMA_CHANNEL_FULL    ( 1 << 0 )  // Not a lite channel
+
+/*
+ * Reserves a free DMA channel, a lite one unless DMA_CHANNEL_FULL is given
+ * (lite channels are preferred otherwise). handler is called (with ctx) on
+ * the IRQ of the channel, raised by the control blocks with DMA_TI_INTEN set:
+ * it must call dma_ack.
+ * @return the channel, -1 if none is left.
+ */
+int dma_channel_alloc ( uint32_t flags, interrupt_handler_t handler,
+        void * ctx );
+
+/*
+ * Runs the chain of control blocks starting at cb.
+ * ASSERT: the channel is idle.
+ */
+void dma_start ( int chan, const struct dma_cb * cb );
+
+// @return whether the channel still has control blocks to go through
+int dma_busy ( int chan );
+
+/*
+ * Acknowledges the interrupt of the channel.
+ * @return whether it was raised.
+ */
+int dma_ack ( int chan );
+
+/*
+ * Asynchronous copies, run one after the other by a channel of their own.
+ * done is called with ctx once the transfer is over, from the DMA interrupt
+ * handler: it must not block (see dma_done_signal). It may be null. status
+ * is 0 on success, -1 if the engine reported an error: the channel is then
+ * reset, the error counted (see dma_get_errors), and the next transfer run.
+ * Buffers must not be touched until then.
+ * @return 0 if the transfer is queued, -1 if n is too large or if too many
+ * transfers are pending.
+ */
+typedef void ( * dma_done_t ) ( void * ctx, int status );
+
+int dma_memcpy ( void * dst, const void * src, uint32_t n, dma_done_t done,
+        void * ctx );
+int dma_memset ( void * dst, uint8_t c, uint32_t n, dma_done_t done,
+        void * ctx );
+
+/*
+ * Completion callback signaling a semaphore, given as ctx with DMA_SEM:
+ *     dma_memcpy ( dst, src, n, dma_done_signal, DMA_SEM ( sem ) );
+ *     wait ( sem );
+ */
+#define DMA_SEM(sem) ( ( void * ) ( intptr_t ) ( sem ) )
+void dma_done_signal ( void * sem, int status );
+
+// @return the number of asynchronous copies which failed since boot
+uint32_t dma_get_errors ( );
+
+// Reserves the channel of the asynchronous copies
+void dma_init ( );
+
+/*
+ * Bus addresses to give the DMA engine, for memory and for peripheral
+ * registers (as mapped at PERI_BASE).
+ */
+uint32_t dma_bus_addr ( const volatile void * ptr );
+uint32_t dma_peri_bus_addr ( uint32_t addr );
+
+#endif
@@ -1,7 +1,7 @@
 #include "gpio.h"
 #include "gpio_regs.h"
 #include "bcm2835.h"
-#include "../arm.h" // cdelay
+#include "systimer.h" // udelay
 
 #include <stdint.h>
 
@@ -34,13 +34,13 @@ void gpio_configure_pull_up_down ( unsigned char gpioPin, unsigned char state )
     gpio_w32 ( GPPUD, state );
 
     // Wait 150 cycles (control signal is setting up)
-    cdelay ( 150 );
+    udelay ( 1 );
 
     // Clock the control signal in for the GPIO we want to impact
     gpio_w32i ( GPPUDCLK0, gpioPin >> 5, gpioPin );
 
     // Wait 150 cycles (required hold time for control signal)
-    cdelay ( 150 );
+    udelay ( 1 );
 
     // Remove control signal
     gpio_w32 ( GPPUD, 0 );
@@ -1,6 +1,8 @@
 #include "pic.h"
 #include "bcm2835.h"
 #include "../scheduler.h"
+#include "../arm.h"
+#include "../icache.h"
 
 struct pic
 {
@@ -28,28 +30,285 @@ static volatile struct pic * pic =
 // Tranform relative IRQ number to an absolute one
 #define irq2abs(reg, irq_rel) ( irq_rel + ( reg << 5 ) )
 
+/* Summary bits of basic_pending: a bank has to be read only if one of its
+ * IRQ is pending. Some IRQ are not reported in the "bank pending" bit but only
+ * in a shortcut bit of their own (IRQ 7, 9, 10, 18, 19 and 53 to 57, 62). */
+#define PIC_BASIC_PENDING1      ( 1 << 8 )
+#define PIC_BASIC_PENDING2      ( 1 << 9 )
+#define PIC_BASIC_SHORTCUT1     0x00007c00
+#define PIC_BASIC_SHORTCUT2     0x001f8000
+
+#define PIC_FIQ_ENABLE          ( 1 << 7 )
+
 // Private cache of currently enabled interrupts
 static uint32_t irq_mask [ 2 ];
 
+// IRQ routed to FIQ (-1 if none), and whether it is escalated to IRQ
+static int fiq_irq = -1;
+static volatile int fiq_escalated;
+static interrupt_handler_t fiq_handler;
+
+struct irq_desc
+{
+    interrupt_handler_t handler;
+    void * ctx;
+    uint32_t prio;
+
+    struct pic_irq_stats stats;
+};
+
+// IRQ of each priority level (bitmaps, one word per register)
+static uint32_t prio_irqs [ PIC_PRIO_LEVELS ] [ 2 ] =
+{
+    [ PIC_PRIO_LOW ] = { ~0U, ~0U },
+};
+
+// IRQ masked at the PIC by the handlers in progress
+static uint32_t prio_masked [ 2 ];
+
+// Number of nested irq_dispatch, and reschedule requests to be honored
+static uint32_t irq_nesting;
+static int irq_reschedule;
+
 // List of all interrupt handlers
-interrupt_handler_t interrupt_handlers [ IRQ_NUMBER ];
+static struct irq_desc irq_descs [ IRQ_NUMBER ];
+
+int pic_register_handler ( int irq, interrupt_handler_t handler, void * ctx )
+{
+    if ( irq < 0 || irq >= IRQ_NUMBER )
+    {
+        return -1;
+    }
+
+    uint32_t irqmask = irq_disable ( );
+
+    irq_descs [ irq ].handler = handler;
+    irq_descs [ irq ].ctx = ctx;
+
+    irq_restore ( irqmask );
+    return 0;
+}
+
+int pic_set_priority ( int irq, uint32_t prio )
+{
+    if ( irq < 0 || irq >= IRQ_NUMBER || prio >= PIC_PRIO_LEVELS )
+    {
+        return -1;
+    }
+
+    uint32_t irqmask = irq_disable ( );
+
+    prio_irqs [ irq_descs [ irq ].prio ] [ irq2reg ] &= ~( 1 << irq2rel );
+    prio_irqs [ prio ] [ irq2reg ] |= ( 1 << irq2rel );
+    irq_descs [ irq ].prio = prio;
+
+    irq_restore ( irqmask );
+    return 0;
+}
+
+int pic_get_irq_stats ( int irq, struct pic_irq_stats * stats )
+{
+    if ( irq < 0 || irq >= IRQ_NUMBER )
+    {
+        return -1;
+    }
+
+    // Take a consistent snapshot (the FIQ updates its stats too)
+    uint32_t irqmask = fiq_disable ( );
+    * stats = irq_descs [ irq ].stats;
+    irq_restore ( irqmask );
+
+    return 0;
+}
+
+int pic_in_interrupt ( )
+{
+    return irq_nesting || ( arm_get_cpsr ( ) & ARM_MODE_MASK ) == ARM_MODE_FIQ;
+}
+
+int pic_route_fiq ( int irq, interrupt_handler_t fiq_handler_,
+        interrupt_handler_t irq_handler, void * ctx )
+{
+    if ( irq < 0 || irq >= IRQ_NUMBER )
+    {
+        return -1;
+    }
+
+    uint32_t irqmask = fiq_disable ( );
+
+    pic -> fiq_ctrl = 0;
+
+    fiq_irq = irq;
+    fiq_escalated = 0;
+    fiq_handler = fiq_handler_;
+    irq_descs [ irq ].handler = irq_handler;
+    irq_descs [ irq ].ctx = ctx;
+
+    /* The IRQ is marked enabled so that irq_dispatch handles it once
+     * escalated, but only the FIQ is actually enabled at the PIC */
+    irq_mask [ irq2reg ] |= ( 1 << irq2rel );
+    ( & ( pic -> disable1 ) ) [ irq2reg ] = ( 1 << irq2rel );
+    pic -> fiq_ctrl = PIC_FIQ_ENABLE | irq;
+
+    irq_restore ( irqmask );
+    return 0;
+}
+
+void pic_fiq_escalate ( )
+{
+    int irq = fiq_irq;
+
+    pic -> fiq_ctrl = 0;
+    fiq_escalated = 1;
+
+    // Masked by a handler in progress: it is enabled back when it completes
+    if ( ! ( prio_masked [ irq2reg ] & ( 1 << irq2rel ) ) )
+    {
+        ( & ( pic -> enable1 ) ) [ irq2reg ] = ( 1 << irq2rel );
+    }
+}
+
+void pic_fiq_resume ( )
+{
+    int irq = fiq_irq;
+
+    uint32_t irqmask = fiq_disable ( );
+
+    fiq_escalated = 0;
+    ( & ( pic -> disable1 ) ) [ irq2reg ] = ( 1 << irq2rel );
+    pic -> fiq_ctrl = PIC_FIQ_ENABLE | irq;
+
+    irq_restore ( irqmask );
+}
+
+void fiq_dispatch ( )
+{
+    struct irq_desc * desc = & ( irq_descs [ fiq_irq ] );
+
+    uint32_t start = arm_get_cycle_count ( );
+    ( * fiq_handler ) ( desc -> ctx );
+
+    desc -> stats.count++;
+    desc -> stats.cycles += arm_get_cycle_count ( ) - start;
+}
 
 void pic_enable_irq ( int irq )
 {
+    uint32_t irqmask = fiq_disable ( );
+
     if ( ! ( irq_mask [ irq2reg ]  & ( 1 << irq2rel ) ) )
     {
         irq_mask [ irq2reg ] |= ( 1 << irq2rel );
-        ( & ( pic -> enable1 ) ) [ irq2reg ] = ( 1 << irq2rel );
+
+        // Masked by a handler in progress: it is enabled back when it completes
+        if ( ! ( prio_masked [ irq2reg ] & ( 1 << irq2rel ) ) )
+        {
+            ( & ( pic -> enable1 ) ) [ irq2reg ] = ( 1 << irq2rel );
+        }
     }
+
+    irq_restore ( irqmask );
 }
 
 void pic_disable_irq ( int irq )
 {
+    uint32_t irqmask = fiq_disable ( );
+
     if ( irq_mask [ irq2reg ] & ( 1 << irq2rel ) )
     {
         irq_mask [ irq2reg ] &= ~( 1 << irq2rel );
         ( & ( pic -> disable1 ) ) [ irq2reg ] = ( 1 << irq2rel );
     }
+
+    irq_restore ( irqmask );
+}
+
+/*
+ * Masks at the PIC all enabled IRQ of priority prio or lower, and returns the
+ * ones that were not masked yet in masked.
+ */
+static ICACHE_HOT void pic_mask_prio ( uint32_t prio, uint32_t masked [ 2 ] )
+{
+    uint32_t irqmask = fiq_disable ( );
+
+    for ( uint32_t reg = 0 ; reg < 2 ; ++reg )
+    {
+        uint32_t bits = 0;
+        for ( uint32_t p = 0 ; p <= prio ; ++p )
+        {
+            bits |= prio_irqs [ p ] [ reg ];
+        }
+
+        bits &= irq_mask [ reg ] & ~prio_masked [ reg ];
+
+        prio_masked [ reg ] |= bits;
+        masked [ reg ] = bits;
+        ( & ( pic -> disable1 ) ) [ reg ] = bits;
+    }
+
+    irq_restore ( irqmask );
+}
+
+// Enables back IRQ masked by pic_mask_prio
+static ICACHE_HOT void pic_unmask_prio ( uint32_t masked [ 2 ] )
+{
+    uint32_t irqmask = fiq_disable ( );
+
+    for ( uint32_t reg = 0 ; reg < 2 ; ++reg )
+    {
+        prio_masked [ reg ] &= ~masked [ reg ];
+
+        // Disabled meanwhile
+        uint32_t bits = masked [ reg ] & irq_mask [ reg ];
+
+        // An IRQ routed to FIQ has to stay disabled unless escalated
+        if ( fiq_irq >= 0 && ! fiq_escalated )
+        {
+            int irq = fiq_irq;
+            if ( ( uint32_t ) irq2reg == reg )
+            {
+                bits &= ~( 1 << irq2rel );
+            }
+        }
+
+        ( & ( pic -> enable1 ) ) [ reg ] = bits;
+    }
+
+    irq_restore ( irqmask );
+}
+
+/*
+ * Runs the handler of irq with IRQ enabled: only IRQ of higher priority can
+ * preempt it.
+ * ASSERT: IRQ have to be disabled prior to call.
+ */
+static ICACHE_HOT int pic_run_handler ( uint32_t irq )
+{
+    struct irq_desc * desc = & ( irq_descs [ irq ] );
+    uint32_t masked [ 2 ];
+    int ret;
+
+    if ( ! desc -> handler )
+    {
+        return PIC_HANDLED;
+    }
+
+    pic_mask_prio ( desc -> prio, masked );
+    irq_enable ( );
+
+    // Call specific handler!
+    uint32_t start = arm_get_cycle_count ( );
+    ret = ( * desc -> handler ) ( desc -> ctx );
+    uint32_t cycles = arm_get_cycle_count ( ) - start;
+
+    // Not traced: the exception return ends this section, not irq_restore
+    ( irq_disable ) ( );
+    pic_unmask_prio ( masked );
+
+    desc -> stats.count++;
+    desc -> stats.cycles += cycles;
+
+    return ret;
 }
 
 void pic_disable_all_interrupts ( )
@@ -61,44 +320,73 @@ void pic_disable_all_interrupts ( )
     pic -> disable1 = ~0;
     pic -> disable2 = ~0;
     pic -> fiq_ctrl = 0;
+    fiq_irq = -1;
 }
 
-void * irq_dispatch ( void * oldSP )
+/*
+ * Called by irq_handler in SVC mode, on the stack of the interrupted code (or
+ * of the interrupted handler), with IRQ disabled.
+ */
+ICACHE_HOT void * irq_dispatch ( void * oldSP )
 {
-    void * newSP = oldSP;
+    uint32_t pending [ 2 ] = { 0, 0 };
 
-    for ( uint32_t reg = 0 ; reg < 2 ; ++reg )
+    // Read each pending register once, and only if it has a pending IRQ
+    uint32_t basic = pic -> basic_pending;
+
+    if ( basic & ( PIC_BASIC_PENDING1 | PIC_BASIC_SHORTCUT1 ) )
     {
-        uint32_t mask = irq_mask [ reg ];
-        while ( mask )
+        pending [ 0 ] = pic -> pending1 & irq_mask [ 0 ] & ~prio_masked [ 0 ];
+    }
+
+    if ( basic & ( PIC_BASIC_PENDING2 | PIC_BASIC_SHORTCUT2 ) )
+    {
+        pending [ 1 ] = pic -> pending2 & irq_mask [ 1 ] & ~prio_masked [ 1 ];
+    }
+
+    // An IRQ routed to FIQ is ours only when escalated
+    if ( fiq_irq >= 0 && ! fiq_escalated )
+    {
+        int irq = fiq_irq;
+        pending [ irq2reg ] &= ~( 1 << irq2rel );
+    }
+
+    irq_nesting++;
+
+    // Handle pending IRQ by decreasing priority
+    for ( int prio = PIC_PRIO_LEVELS - 1 ; prio >= 0 ; --prio )
+    {
+        for ( uint32_t reg = 0 ; reg < 2 ; ++reg )
         {
-            // Fetch the position of the first set bit
-            // This leverages our ARM CPU "clz" instruction
-            // This is our IRQ relative number
-            uint32_t irq_rel = 31 - __builtin_clz ( mask );
+            uint32_t irqs = pending [ reg ] & prio_irqs [ prio ] [ reg ];
 
-            // Check if interrupt is pending
-            if ( ( & ( pic -> pending1 ) ) [ reg ] & ( 1 << irq_rel ) )
+            while ( irqs )
             {
+                // Fetch the position of the first set bit
+                // This leverages our ARM CPU "clz" instruction
+                // This is our IRQ relative number
+                uint32_t irq_rel = 31 - __builtin_clz ( irqs );
+                irqs ^= ( 1 << irq_rel );
+
                 // Convert to absolute IRQ number
-                uint32_t irq = irq2abs ( reg, irq_rel );
-
-                // Special case for scheduler -- FIXME :(
-                if ( irq == IRQ_TIMER1 )
-                {
-                    newSP = scheduler_handler ( oldSP );
-                }
-
-                // Call specific handler!
-                else if ( interrupt_handlers [ irq ] )
-                {
-                    ( * interrupt_handlers [ irq ] ) ( );
-                }
-            }
+                int ret = pic_run_handler ( irq2abs ( reg, irq_rel ) );
 
-            mask &= ~( 1 << irq_rel );
+                // Nested handlers may have requested a reschedule meanwhile
+                irq_reschedule |= ret;
+            }
         }
     }
 
-    return newSP;
+    irq_nesting--;
+
+    /* Elect a process once, whatever the number of handlers asking for it, and
+     * only when leaving the outermost handler: nested ones return to the
+     * handler they preempted, not to a process */
+    if ( irq_nesting == 0 && irq_reschedule )
+    {
+        irq_reschedule = 0;
+        return scheduler_handler ( oldSP );
+    }
+
+    return oldSP;
 }
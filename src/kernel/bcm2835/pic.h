@@ -10,10 +10,77 @@
 #define IRQ_TIMER2  2
 #define IRQ_TIMER3  3
 #define IRQ_USB_HCD 9
+#define IRQ_DMA0    16  // Up to IRQ_DMA0 + 12 for DMA channel 12
 #define IRQ_UART    57
 
-typedef void ( * interrupt_handler_t ) ( void );
-extern interrupt_handler_t interrupt_handlers [ IRQ_NUMBER ];
+// Values returned by interrupt handlers
+#define PIC_HANDLED     0
+#define PIC_RESCHEDULE  1   // Elect a process again once all IRQ are handled
+
+/*
+ * Interrupt handlers are given back the context they were registered with.
+ * They must acknowledge their interrupt at the device.
+ */
+typedef int ( * interrupt_handler_t ) ( void * ctx );
+
+/*
+ * IRQ priorities. Handlers run with IRQ enabled, and can be preempted by the
+ * handlers of IRQ of strictly higher priority only. IRQ default to
+ * PIC_PRIO_LOW.
+ */
+#define PIC_PRIO_LOW        0
+#define PIC_PRIO_NORMAL     1
+#define PIC_PRIO_HIGH       2
+#define PIC_PRIO_HIGHEST    3
+#define PIC_PRIO_LEVELS     4
+
+struct pic_irq_stats
+{
+    uint32_t count;     // Number of times the handler ran
+    uint64_t cycles;    // CPU cycles spent in the handler (and its preemptors)
+};
+
+// NOTE: for an IRQ routed to FIQ, both its handlers are accounted
+
+/*
+ * Sets the handler of an IRQ (null to remove it). The IRQ still has to be
+ * enabled with pic_enable_irq.
+ * @return 0 on success, -1 on invalid IRQ number.
+ */
+int pic_register_handler ( int irq, interrupt_handler_t handler, void * ctx );
+
+// @return 0 on success, -1 on invalid IRQ number or priority.
+int pic_set_priority ( int irq, uint32_t prio );
+
+// @return 0 and the statistics of irq in stats, -1 on invalid IRQ number.
+int pic_get_irq_stats ( int irq, struct pic_irq_stats * stats );
+
+/*
+ * @return whether the caller runs in an interrupt handler (IRQ or FIQ), where
+ * it must not block.
+ */
+int pic_in_interrupt ( );
+
+/*
+ * Routes irq to the FIQ: its handler then runs in FIQ mode, with IRQ and FIQ
+ * masked, and may preempt code running with IRQ disabled. Only one IRQ can be
+ * routed to the FIQ at a time. Such an IRQ must not be enabled with
+ * pic_enable_irq. Its return value is ignored.
+ * irq_handler (registered with pic_register_handler) is called in IRQ mode
+ * each time the FIQ handler escalates (see pic_fiq_escalate).
+ * @return 0 on success, -1 on invalid IRQ number.
+ */
+int pic_route_fiq ( int irq, interrupt_handler_t fiq_handler,
+        interrupt_handler_t irq_handler, void * ctx );
+
+/*
+ * For the FIQ handler: routes the interrupt back to IRQ, for work that can't
+ * be done at FIQ level. The FIQ is disabled until pic_fiq_resume is called.
+ */
+void pic_fiq_escalate ( );
+
+// For the IRQ handler: routes the interrupt to the FIQ again
+void pic_fiq_resume ( );
 
 void pic_enable_irq ( int irq );
 void pic_disable_irq ( int irq );
@@ -1,12 +1,24 @@
 #include "systimer.h"
 #include "bcm2835.h"
 #include "pic.h"
+#include "../icache.h"
 
 static volatile struct systimer * systimer =
     ( volatile struct systimer * ) SYSTIMER_BASE;
 
+// Channel 1 ticks the scheduler: the next tick is set by the election
+static ICACHE_HOT int systimer_interrupt ( void * ctx )
+{
+    ( void ) ctx;
+
+    systimer -> cs = SYSTIMER_MATCH1;
+    return PIC_RESCHEDULE;
+}
+
 void systimer_init ( )
 {
+    pic_register_handler ( IRQ_TIMER1, systimer_interrupt, 0 );
+    pic_set_priority ( IRQ_TIMER1, PIC_PRIO_HIGHEST );
     pic_enable_irq ( IRQ_TIMER1 );
 }
 
@@ -23,3 +35,12 @@ void systimer_update ( uint32_t offset )
     // Then, set next tick
     systimer -> c1 = ( systimer -> clo ) + offset;
 }
+
+void udelay ( uint32_t usec )
+{
+    uint32_t start = systimer -> clo;
+
+    /* The first tick may come right after start was read: wait for one more
+     * to be sure at least usec microseconds have elapsed */
+    while ( systimer -> clo - start <= usec );
+}
@@ -21,6 +21,21 @@ struct systimer
 
 void systimer_init ( );
 uint32_t systimer_get_clock ( );
+
+/*
+ * Wrap-around safe comparison of two dates of systimer_get_clock: true if a
+ * comes before b. Dates must be less than 35min47sec apart.
+ */
+static inline int systimer_date_before ( uint32_t a, uint32_t b )
+{
+    return ( int32_t ) ( a - b ) < 0;
+}
 void systimer_update ( uint32_t offset );
 
+/*
+ * Busy-waits for at least usec microseconds, whatever the CPU clock.
+ * Only meant for short hardware delays: longer ones should sleep instead.
+ */
+void udelay ( uint32_t usec );
+
 #endif
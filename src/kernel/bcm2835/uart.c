@@ -5,18 +5,194 @@
 #include "power.h"
 #include "pic.h"
 #include "watchdog.h"
+#include "dma.h"
+
+#include "../config.h"
+#include "../arm.h"
+#include "../semaphore.h"
+#include "../pcb.h"
+#include "../pcb_turnstile.h"
+#include "../scheduler.h"
 
 #include <stdint.h>
 
-#define UART_CLK 3000000
+#define UART_TX_RING_MASK ( KERNEL_UART_TX_RING_SIZE - 1 )
+#define UART_RX_RING_MASK ( KERNEL_UART_RX_RING_SIZE - 1 )
+
+// Ctrl-R
+#define UART_KEY_RESET 0x12
 
 #define uart_reg(reg) ( ( uint32_t volatile * ) ( UART_BASE + reg ) )
 #define uart_r32(reg) * uart_reg ( reg )
 #define uart_w32(reg,data) * uart_reg ( reg ) = data
 
+// Output waiting for room in the TX FIFO
+static char uart_tx_ring [ KERNEL_UART_TX_RING_SIZE ];
+static uint32_t uart_tx_head;
+static uint32_t uart_tx_tail;
+
+// Input waiting to be read, counted by uart_rx_sem
+static char uart_rx_ring [ KERNEL_UART_RX_RING_SIZE ];
+static uint32_t uart_rx_head;
+static uint32_t uart_rx_tail;
+static sem_t uart_rx_sem;
+
+/* Bulk output sent by the DMA engine. The UART only takes 32 bits writes to
+ * DR: bytes are spread to words in a staging buffer, one chunk at a time. */
+#define UART_DMA_CHUNK 1024
+
+// How often to look whether the ring is empty before a transfer (in us)
+#define UART_DMA_RING_POLL 1000
+static uint32_t uart_dma_words [ UART_DMA_CHUNK ];
+static struct dma_cb uart_dma_cb;
+static int uart_dma_chan = -1;
+static const uint8_t * uart_dma_src;
+static uint32_t uart_dma_left;
+static volatile int uart_dma_active;
+static sem_t uart_dma_done;
+static sem_t uart_dma_lock;
+
+/* Writers waiting for the end of the DMA transfer to queue output. Writers
+ * that can't sleep drop it instead, counted in uart_tx_dropped. */
+static kernel_pcb_turnstile_t uart_tx_waitq;
+static uint32_t uart_tx_dropped;
+
+/*
+ * Moves queued bytes to the TX FIFO until it is full. The TX interrupt is
+ * only wanted while bytes are left.
+ * ASSERT: IRQ have to be disabled prior to call.
+ */
+static void uart_tx_fill ( )
+{
+    // The DMA engine owns the FIFO: the ring resumes once it's done
+    if ( uart_dma_active )
+    {
+        uart_w32 ( IMSC, uart_r32 ( IMSC ) & ~INT_TXI );
+        return;
+    }
+
+    while ( uart_tx_tail != uart_tx_head && ! ( uart_r32 ( FR ) & FR_TXFF ) )
+    {
+        uart_w32 ( DR, uart_tx_ring [ uart_tx_tail & UART_TX_RING_MASK ] );
+        uart_tx_tail++;
+    }
+
+    if ( uart_tx_tail == uart_tx_head )
+    {
+        uart_w32 ( IMSC, uart_r32 ( IMSC ) & ~INT_TXI );
+    }
+    else
+    {
+        uart_w32 ( IMSC, uart_r32 ( IMSC ) | INT_TXI );
+    }
+}
+
+/*
+ * Stages the next chunk of the DMA transfer and starts the engine on it.
+ * ASSERT: IRQ have to be disabled prior to call, bytes are left.
+ */
+static void uart_dma_next_chunk ( )
+{
+    uint32_t n = uart_dma_left < UART_DMA_CHUNK ? uart_dma_left : UART_DMA_CHUNK;
+
+    for ( uint32_t i = 0 ; i < n ; ++i )
+    {
+        uart_dma_words [ i ] = uart_dma_src [ i ];
+    }
+
+    uart_dma_src += n;
+    uart_dma_left -= n;
+
+    uart_dma_cb.ti = DMA_TI_INTEN | DMA_TI_WAIT_RESP | DMA_TI_SRC_INC |
+        DMA_TI_DEST_DREQ | DMA_TI_PERMAP ( DMA_DREQ_UART_TX );
+    uart_dma_cb.source_ad = dma_bus_addr ( uart_dma_words );
+    uart_dma_cb.dest_ad = dma_peri_bus_addr ( UART_BASE + DR );
+    uart_dma_cb.txfr_len = n * sizeof ( uint32_t );
+    uart_dma_cb.stride = 0;
+    uart_dma_cb.nextconbk = 0;
+
+    dma_start ( uart_dma_chan, & uart_dma_cb );
+}
+
+/*
+ * Moves the DMA transfer forward once the engine is done with a chunk: starts
+ * the next one, or hands the FIFO back to the ring.
+ * @return whether the transfer is over.
+ * ASSERT: IRQ have to be disabled prior to call.
+ */
+static int uart_dma_progress ( )
+{
+    if ( ! uart_dma_active || dma_busy ( uart_dma_chan ) )
+    {
+        return 0;
+    }
+
+    dma_ack ( uart_dma_chan );
+
+    if ( uart_dma_left )
+    {
+        uart_dma_next_chunk ( );
+        return 0;
+    }
+
+    uart_w32 ( DMACR, 0 );
+    uart_dma_active = 0;
+    signal ( uart_dma_done );
+    while ( pcb_wakeup ( &uart_tx_waitq ) );
+
+    // Output queued meanwhile
+    uart_tx_fill ( );
+
+    return 1;
+}
+
+static int uart_dma_interrupt ( void * ctx )
+{
+    ( void ) ctx;
+
+    uint32_t irqmask = irq_disable ( );
+
+    // Make sure nothing is pending if the transfer was completed by polling
+    dma_ack ( uart_dma_chan );
+    int done = uart_dma_progress ( );
+
+    irq_restore ( irqmask );
+
+    return done ? PIC_RESCHEDULE : PIC_HANDLED;
+}
+
+/*
+ * Makes room in the TX FIFO the slow way, for callers that can't wait for
+ * interrupts. While a DMA transfer owns the FIFO, processes sleep until it
+ * is over: a transfer lasts many chunks, not to be waited for with IRQ
+ * disabled.
+ * @return 0 once the ring may move again, -1 if the caller can't sleep
+ * through the DMA transfer.
+ * ASSERT: IRQ have to be disabled prior to call.
+ */
+static int uart_tx_poll ( )
+{
+    if ( uart_dma_active )
+    {
+        if ( pic_in_interrupt ( ) ||
+             ( arm_get_cpsr ( ) & ARM_MODE_MASK ) != ARM_MODE_SVC )
+        {
+            return -1;
+        }
+
+        pcb_block ( pcb_running, &uart_tx_waitq, PCB_TIMEOUT_NONE );
+        return 0;
+    }
+
+    while ( uart_r32 ( FR ) & FR_TXFF );
+    uart_tx_fill ( );
+
+    return 0;
+}
+
 static void uart_set_baud_rate ( int brate )
 {
-    float baudiv = ( float ) UART_CLK / ( 16 * brate );
+    float baudiv = ( float ) KERNEL_UART_CLOCK / ( 16 * brate );
     int baudiv_int = baudiv;
     int baudiv_frac = ( ( baudiv - baudiv_int ) * ( FBRD_MASK + 1 ) + 0.5 );
 
@@ -24,17 +200,57 @@ static void uart_set_baud_rate ( int brate )
     uart_w32 ( FBRD, baudiv_frac & FBRD_MASK );
 }
 
-void uart_interrupt ( )
+static int uart_interrupt ( void * ctx )
 {
-    // Acknowledge interrupt
-    uart_w32 ( ICR, INT_RXI );
+    ( void ) ctx;
+
+    int ret = PIC_HANDLED;
+    uint32_t mis = uart_r32 ( MIS );
+
+    // Room in the TX FIFO: send what's queued
+    if ( mis & INT_TXI )
+    {
+        uint32_t irqmask = irq_disable ( );
+        uart_tx_fill ( );
+        uart_w32 ( ICR, INT_TXI );
+        irq_restore ( irqmask );
+    }
 
-    // Restart the system when pressing "R" key
-    if ( ( uart_r32 ( DR ) & DR_DATA ) == 'R' )
+    if ( mis & ( INT_RXI | INT_RTI ) )
     {
-        watchdog_start ( 1 );
-        for ( ; ; );
+        // Acknowledge interrupt
+        uart_w32 ( ICR, INT_RXI | INT_RTI );
+
+        while ( ! ( uart_r32 ( FR ) & FR_RXFE ) )
+        {
+            char c = uart_r32 ( DR ) & DR_DATA;
+
+            // Restart the system when pressing Ctrl-R
+            if ( c == UART_KEY_RESET )
+            {
+                uart_flush ( );
+                watchdog_start ( 1 );
+                for ( ; ; );
+            }
+
+            uint32_t irqmask = irq_disable ( );
+
+            // Drop the byte if nobody reads them
+            if ( uart_rx_head - uart_rx_tail < KERNEL_UART_RX_RING_SIZE )
+            {
+                uart_rx_ring [ uart_rx_head & UART_RX_RING_MASK ] = c;
+                uart_rx_head++;
+
+                // Let the reader run soon
+                signal ( uart_rx_sem );
+                ret = PIC_RESCHEDULE;
+            }
+
+            irq_restore ( irqmask );
+        }
     }
+
+    return ret;
 }
 
 void uart_init ( )
@@ -51,22 +267,158 @@ void uart_init ( )
 
     // Configure the UART
     uart_w32 ( ICR, INT_ALL ); // Clear all interrupts
-    uart_set_baud_rate ( 115200 );
-    uart_w32 ( LCRH, LCRH_WLEN_8BITS );
+    uart_set_baud_rate ( KERNEL_UART_BAUD_RATE );
+    uart_w32 ( LCRH, LCRH_WLEN_8BITS | LCRH_FEN );
+
+    /* TX interrupt when the FIFO drains to 1/4, RX interrupt at 1/2 (or after
+     * a timeout if fewer bytes are received) */
+    uart_w32 ( IFLS, IFLS_TXIFLSEL_1_4 | IFLS_RXIFLSEL_1_2 );
 
     // Setup interrupts
-    uart_w32 ( IMSC, INT_RXI );
-    interrupt_handlers [ IRQ_UART ] = uart_interrupt;
+    uart_rx_sem = sem_create ( 0 );
+    uart_w32 ( IMSC, INT_RXI | INT_RTI );
+    pic_register_handler ( IRQ_UART, uart_interrupt, 0 );
+    pic_set_priority ( IRQ_UART, PIC_PRIO_HIGH );
     pic_enable_irq ( IRQ_UART );
 
+    // Without a DMA channel, bulk output goes through the ring
+    uart_dma_done = sem_create ( 0 );
+    uart_dma_lock = sem_create ( 1 );
+    pcb_turnstile_init ( &uart_tx_waitq );
+    uart_dma_chan = dma_channel_alloc ( 0, uart_dma_interrupt, 0 );
+
     // Enable TX, RX and enable the UART
     uart_w32 ( CR, CR_TXE | CR_RXE | CR_UARTEN );
 }
 
 static void uart_write_char ( char c )
 {
-    while ( uart_r32 ( FR ) & FR_TXFF );
-    uart_w32 ( DR, c );
+    uint32_t irqmask = irq_disable ( );
+
+    // Queue is full: make room the slow way, by waiting for the FIFO
+    while ( uart_tx_head - uart_tx_tail == KERNEL_UART_TX_RING_SIZE )
+    {
+        if ( uart_tx_poll ( ) != 0 )
+        {
+            uart_tx_dropped++;
+            irq_restore ( irqmask );
+            return;
+        }
+    }
+
+    uart_tx_ring [ uart_tx_head & UART_TX_RING_MASK ] = c;
+    uart_tx_head++;
+
+    /* The TX interrupt only fires when the FIFO level crosses the threshold:
+     * start filling the FIFO ourselves */
+    uart_tx_fill ( );
+
+    irq_restore ( irqmask );
+}
+
+int uart_try_write ( const void * buf, uint32_t n )
+{
+    const char * str = buf;
+    uint32_t irqmask = irq_disable ( );
+
+    if ( KERNEL_UART_TX_RING_SIZE - ( uart_tx_head - uart_tx_tail ) < n )
+    {
+        irq_restore ( irqmask );
+        return -1;
+    }
+
+    for ( uint32_t i = 0 ; i < n ; ++i )
+    {
+        uart_tx_ring [ uart_tx_head & UART_TX_RING_MASK ] = str [ i ];
+        uart_tx_head++;
+    }
+
+    uart_tx_fill ( );
+
+    irq_restore ( irqmask );
+    return 0;
+}
+
+void uart_flush ( )
+{
+    uint32_t irqmask = irq_disable ( );
+
+    while ( uart_dma_active || uart_tx_tail != uart_tx_head )
+    {
+        // Can't sleep through the DMA transfer: leave the rest to it
+        if ( uart_tx_poll ( ) != 0 )
+        {
+            irq_restore ( irqmask );
+            return;
+        }
+    }
+
+    // Wait for the last byte to leave the shift register
+    while ( uart_r32 ( FR ) & FR_BUSY );
+
+    irq_restore ( irqmask );
+}
+
+int uart_write_dma ( const void * buf, uint32_t n )
+{
+    if ( uart_dma_chan < 0 )
+    {
+        const char * str = buf;
+        for ( uint32_t i = 0 ; i < n ; ++i )
+        {
+            uart_write_char ( str [ i ] );
+        }
+
+        return n;
+    }
+
+    if ( n == 0 )
+    {
+        return 0;
+    }
+
+    // One transfer at a time
+    wait ( uart_dma_lock );
+
+    uint32_t irqmask = irq_disable ( );
+
+    // Let queued output go first, without spinning on it
+    while ( uart_tx_tail != uart_tx_head )
+    {
+        pcb_sleep ( pcb_running, UART_DMA_RING_POLL );
+    }
+
+    uart_dma_src = buf;
+    uart_dma_left = n;
+    uart_dma_active = 1;
+
+    uart_w32 ( DMACR, DMACR_TXDMAE );
+    uart_dma_next_chunk ( );
+
+    irq_restore ( irqmask );
+
+    // Nothing to do until the last chunk is sent
+    wait ( uart_dma_done );
+    signal ( uart_dma_lock );
+
+    return n;
+}
+
+uint32_t uart_get_dropped ( )
+{
+    return uart_tx_dropped;
+}
+
+char uart_read_char ( )
+{
+    wait ( uart_rx_sem );
+
+    uint32_t irqmask = irq_disable ( );
+    char c = uart_rx_ring [ uart_rx_tail & UART_RX_RING_MASK ];
+    uart_rx_tail++;
+    irq_restore ( irqmask );
+
+    return c;
 }
 
 void printu ( const char * str )
@@ -108,3 +460,21 @@ void printu_32h ( uint32_t val )
         }
     }
 }
+
+void printu_32d ( uint32_t val )
+{
+    char digits [ 10 ];
+    int n = 0;
+
+    // Digits come least significant first
+    do
+    {
+        digits [ n++ ] = '0' + val % 10;
+        val /= 10;
+    } while ( val );
+
+    while ( n-- )
+    {
+        uart_write_char ( digits [ n ] );
+    }
+}
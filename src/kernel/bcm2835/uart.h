@@ -4,8 +4,47 @@
 #include <stdint.h>
 
 void uart_init ( );
+
+/*
+ * Output is queued and sent from the TX interrupt: printing returns right
+ * away unless the queue is full. uart_flush waits until everything queued
+ * has left the UART, e.g. before a reset.
+ *
+ * While a DMA transfer (see uart_write_dma) holds the UART, the queue can't
+ * drain: a process printing to a full queue sleeps until the transfer is
+ * over, an interrupt handler drops its output, and uart_flush called from
+ * an interrupt handler returns without waiting for the transfer.
+ */
+void uart_flush ( );
+
+// @return the number of bytes dropped since boot, see uart_flush
+uint32_t uart_get_dropped ( );
+
+/*
+ * Queues n bytes at once, so that no other output gets in between, if the
+ * queue has room for them.
+ * @return 0 on success, -1 if there is not enough room (nothing is queued).
+ */
+int uart_try_write ( const void * buf, uint32_t n );
+
+/*
+ * Sends n bytes from buf with the DMA engine, once the queued output is gone.
+ * The caller sleeps until the last byte is in the TX FIFO: the CPU only
+ * wakes up between chunks. Printing meanwhile is queued (see uart_flush if
+ * the queue is full).
+ * Not for interrupt handlers. buf must stay valid until it returns.
+ * @return n.
+ */
+int uart_write_dma ( const void * buf, uint32_t n );
+
+/*
+ * Received bytes are queued from the RX interrupts. uart_read_char waits for
+ * the next one. Ctrl-R resets the board right away.
+ */
+char uart_read_char ( );
 void printu ( const char * str );
 void printuln ( const char * str );
 void printu_32h ( uint32_t val );
+void printu_32d ( uint32_t val );
 
 #endif
@@ -12,6 +12,7 @@ enum uart_regs
     RIS     = 0x3c, // Raw Interrupt Status Register
     MIS     = 0x40, // Masked Interrupt Status Register
     ICR     = 0x44, // Interrupt Clear Register
+    DMACR   = 0x48, // DMA Control Register
 
     ITCR    = 0x80, // Test Control Register
     ITIP    = 0x84, // Integration Test Input Register
@@ -125,3 +126,11 @@ enum INT
 
     INT_ALL     = 0x7f2,
 };
+
+// DMA Control Register
+enum DMACR
+{
+    DMACR_DMAONERR  = ( 1 << 2 ),   // Stop RX DMA requests on RX error
+    DMACR_TXDMAE    = ( 1 << 1 ),   // TX DMA Enable
+    DMACR_RXDMAE    = ( 1 << 0 ),   // RX DMA Enable
+};
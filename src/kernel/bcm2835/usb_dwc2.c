@@ -1,14 +1,19 @@
 #include "usb_dwc2_regs.h"
+#include "usb_dwc2_fifos.h"
 
 #include "bcm2835.h"
 #include "power.h"
 #include "pic.h"
+#include "systimer.h"
 #include "uart.h"
 
 #include "../usb_hcdi.h"
-#include "../mailbox.h"
+#include "../msgq.h"
 #include "../semaphore.h"
+#include "../evset.h"
+#include "../bottom_half.h"
 #include "../arm.h"
+#include "../klog.h"
 
 #include "../../api/process.h"
 #include "../../libc/math.h"
@@ -22,8 +27,21 @@ static void dwc2_channel_interrupt ( uint32_t chan );
 static void dwc2_prepare_channel ( uint32_t chan );
 static void dwc2_start_channel ( uint32_t chan );
 static void dwc2_defer_req ( struct usb_request * req );
+static void dwc2_bottom_half ( void * ctx );
 
-static mailbox_t usb_requests_mbox;
+static msgq_t usb_requests_msgq;
+
+// NAKed requests, relaunched by the consumer thread once their date is reached
+static struct usb_request * dwc2_deferred_reqs;
+static sem_t dwc2_deferred_sem;
+
+// The consumer thread waits on both new and deferred requests
+static evset_t dwc2_consumer_evset;
+enum
+{
+    DWC2_EVENT_REQUEST,
+    DWC2_EVENT_DEFERRED,
+};
 
 // Keep track of the number of free channels
 static sem_t dwc2_free_chan_sem;
@@ -34,6 +52,49 @@ static uint16_t dwc2_free_chans;
 // Keep track of USB req for each channel
 static struct usb_request * dwc2_chan_requests [ MAX_CHAN ];
 
+/*
+ * The DWC2 interrupt is routed to the FIQ. The FIQ handler only takes care of
+ * NAKed periodic IN transactions: instead of releasing the channel and
+ * deferring the request, it keeps the channel and re-arms it on the Start Of
+ * Frame of the next (micro)frame the endpoint has to be polled. Everything
+ * else (completions, errors, port events) is escalated to dwc2_interrupt.
+ *
+ * irq_disable does not mask the FIQ: the state below is shared with the FIQ
+ * handler and has to be accessed with fiq_disable.
+ */
+enum dwc2_fiq_state
+{
+    DWC2_FIQ_NONE,          // Channel is not handled by the FIQ
+    DWC2_FIQ_ACTIVE,        // Transaction in progress, NAK are retried
+    DWC2_FIQ_WAIT_FRAME,    // NAKed, to be re-armed on frame
+};
+
+struct dwc2_fiq_chan
+{
+    enum dwc2_fiq_state state;
+
+    // Polling interval and next (micro)frame to poll
+    uint16_t interval;
+    uint16_t frame;
+
+    // Channel programming to restart the transaction with
+    union hctsiz hctsiz;
+    uint32_t hcdma;
+};
+
+static struct dwc2_fiq_chan dwc2_fiq_chans [ MAX_CHAN ];
+
+// Channels waiting for their frame
+static uint32_t dwc2_fiq_waiting;
+
+// (Micro)frame numbers wrap around at 14 bits
+#define DWC2_FRNUM_MASK 0x3fff
+
+// Events left to the bottom half (masked until it handles them)
+static struct bottom_half dwc2_bh;
+static uint32_t dwc2_bh_chans;
+static int dwc2_bh_port;
+
 // This struct holds various Read-Only register values
 static struct hwcfg
 {
@@ -70,7 +131,8 @@ static uint32_t dwc2_get_free_chan ( )
 
 static void dwc2_release_chan ( uint32_t chan )
 {
-    uint32_t irqmask = irq_disable ( );
+    uint32_t irqmask = fiq_disable ( );
+    dwc2_fiq_chans [ chan ].state = DWC2_FIQ_NONE;
     dwc2_free_chans ^= ( 1 << chan );
     signal ( dwc2_free_chan_sem );
     irq_restore ( irqmask );
@@ -85,44 +147,206 @@ static void dwc2_complete_request ( uint32_t chan, enum usb_request_status statu
     usb_request_done ( req );
 }
 
-void dwc2_interrupt ( )
+static void dwc2_fiq_set_sof ( int enable )
+{
+    union gint gintmsk = regs -> core.gintmsk;
+    gintmsk.sof = enable;
+    regs -> core.gintmsk = gintmsk;
+}
+
+// Whether frame has been reached, frame numbers wrapping around
+static int dwc2_frame_reached ( uint16_t frnum, uint16_t frame )
+{
+    return ( ( frnum - frame ) & DWC2_FRNUM_MASK ) <= ( DWC2_FRNUM_MASK >> 1 );
+}
+
+// Restart a NAKed transaction, with the data toggle it was NAKed with
+static void dwc2_fiq_rearm ( uint32_t chan )
+{
+    struct dwc2_fiq_chan * fchan = & ( dwc2_fiq_chans [ chan ] );
+    union hctsiz hctsiz = fchan -> hctsiz;
+
+    hctsiz.pid = regs -> host.hc [ chan ].hctsiz.pid;
+
+    regs -> host.hc [ chan ].hctsiz = hctsiz;
+    regs -> host.hc [ chan ].hcdma = fchan -> hcdma;
+
+    fchan -> state = DWC2_FIQ_ACTIVE;
+    dwc2_start_channel ( chan );
+}
+
+/*
+ * Handles NAKs of FIQ channels and re-arms them on SOF.
+ * @return channels whose interrupt still has to be handled.
+ * ASSERT: FIQ have to be disabled prior to call.
+ */
+static uint32_t dwc2_fiq_housekeeping ( union gint gint )
+{
+    uint16_t frnum = regs -> host.hfnum.frnum & DWC2_FRNUM_MASK;
+    uint32_t chans = 0;
+
+    if ( gint.hchint )
+    {
+        chans = regs -> host.haint & regs -> host.haintmsk;
+
+        uint32_t fiq_chans = chans;
+        while ( fiq_chans )
+        {
+            uint32_t chan = 31 - __builtin_clz ( fiq_chans );
+            fiq_chans ^= ( 1 << chan );
+
+            struct dwc2_fiq_chan * fchan = & ( dwc2_fiq_chans [ chan ] );
+            if ( fchan -> state != DWC2_FIQ_ACTIVE )
+            {
+                continue;
+            }
+
+            // Only a plain NAK is ours: no completion, no error
+            union hcint hcint = regs -> host.hc [ chan ].hcint;
+            union hcint others = hcint;
+            others.nak = 0;
+            others.chhltd = 0;
+
+            if ( ! hcint.nak || others.raw )
+            {
+                continue;
+            }
+
+            regs -> host.hc [ chan ].hcint = hcint;
+
+            // Poll again at the next interval
+            fchan -> frame = ( frnum + fchan -> interval ) & DWC2_FRNUM_MASK;
+            fchan -> state = DWC2_FIQ_WAIT_FRAME;
+            dwc2_fiq_waiting |= ( 1 << chan );
+            chans ^= ( 1 << chan );
+        }
+    }
+
+    if ( gint.sof )
+    {
+        union gint ack;
+        ack.raw = 0;
+        ack.sof = 1;
+        regs -> core.gintsts = ack;
+
+        uint32_t waiting = dwc2_fiq_waiting;
+        while ( waiting )
+        {
+            uint32_t chan = 31 - __builtin_clz ( waiting );
+            waiting ^= ( 1 << chan );
+
+            if ( dwc2_frame_reached ( frnum, dwc2_fiq_chans [ chan ].frame ) )
+            {
+                dwc2_fiq_waiting ^= ( 1 << chan );
+                dwc2_fiq_rearm ( chan );
+            }
+        }
+    }
+
+    // SOF are only needed while channels are waiting for their frame
+    dwc2_fiq_set_sof ( dwc2_fiq_waiting != 0 );
+
+    return chans;
+}
+
+// Pending core interrupts, among the unmasked ones
+static union gint dwc2_read_gint ( )
 {
     union gint gint = regs -> core.gintsts;
+    gint.raw &= regs -> core.gintmsk.raw;
+    return gint;
+}
+
+static int dwc2_fiq ( void * ctx )
+{
+    ( void ) ctx;
+
+    union gint gint = dwc2_read_gint ( );
+
+    // Let dwc2_interrupt handle whatever is left
+    if ( dwc2_fiq_housekeeping ( gint ) || gint.prtint )
+    {
+        pic_fiq_escalate ( );
+    }
+
+    return PIC_HANDLED;
+}
+
+/*
+ * Top half: leaves channel and port events to the bottom half, masking them
+ * until it has handled them.
+ */
+static int dwc2_interrupt ( void * ctx )
+{
+    ( void ) ctx;
+
+    uint32_t irqmask = fiq_disable ( );
+
+    // NAKs and SOF may have come in since the FIQ escalated
+    union gint gint = dwc2_read_gint ( );
+    uint32_t chans = dwc2_fiq_housekeeping ( gint );
+
+    if ( chans )
+    {
+        regs -> host.haintmsk &= ~chans;
+        dwc2_bh_chans |= chans;
+    }
 
-    // Handle host port interrupt
     if ( gint.prtint )
+    {
+        union gint gintmsk = regs -> core.gintmsk;
+        gintmsk.prtint = 0;
+        regs -> core.gintmsk = gintmsk;
+        dwc2_bh_port = 1;
+    }
+
+    irq_restore ( irqmask );
+
+    // Give the interrupt back to the FIQ
+    pic_fiq_resume ( );
+
+    return bh_schedule ( &dwc2_bh );
+}
+
+// Bottom half: handles port and channel events, then unmasks them
+static void dwc2_bottom_half ( void * ctx )
+{
+    ( void ) ctx;
+
+    uint32_t irqmask = fiq_disable ( );
+    uint32_t chans = dwc2_bh_chans;
+    int port = dwc2_bh_port;
+    dwc2_bh_chans = 0;
+    dwc2_bh_port = 0;
+    irq_restore ( irqmask );
+
+    // Handle host port interrupt
+    if ( port )
     {
         dwc2_root_hub_handle_port_interrupt ( );
+
+        irqmask = fiq_disable ( );
+        union gint gintmsk = regs -> core.gintmsk;
+        gintmsk.prtint = 1;
+        regs -> core.gintmsk = gintmsk;
+        irq_restore ( irqmask );
     }
 
     // Channel Interrupt
-    if ( gint.hchint )
+    uint32_t done = chans;
+    while ( chans )
     {
-        uint32_t chans = regs -> host.haint;
-        uint32_t chan;
-        while ( chans )
-        {
-            chan = 31 - __builtin_clz ( chans );
-            chans ^= ( 1 << chan );
-            dwc2_channel_interrupt ( chan );
-        }
+        uint32_t chan = 31 - __builtin_clz ( chans );
+        chans ^= ( 1 << chan );
+        dwc2_channel_interrupt ( chan );
     }
-}
 
-static void dwc2_channel_interrupt_display ( union hcint hcint )
-{
-    if ( hcint.xfercompl )  { printu ( " xfercompl" ); }
-    if ( hcint.chhltd )     { printu ( " chhltd" ); }
-    if ( hcint.ahberr )     { printu ( " ahberr" ); }
-    if ( hcint.stall )      { printu ( " STALL" ); }
-    if ( hcint.nak )        { printu ( " NAK" ); }
-    if ( hcint.ack )        { printu ( " ACK" ); }
-    if ( hcint.nyet )       { printu ( " NYET" ); }
-    if ( hcint.xacterr )    { printu ( " xacterr" ); }
-    if ( hcint.bblerr )     { printu ( " bblerr" ); }
-    if ( hcint.frmovrun )   { printu ( " frmovrun" ); }
-    if ( hcint.datatglerr ) { printu ( " datatglerr" ); }
-    printuln ( 0 );
+    if ( done )
+    {
+        irqmask = fiq_disable ( );
+        regs -> host.haintmsk |= done;
+        irq_restore ( irqmask );
+    }
 }
 
 static void dwc2_channel_interrupt ( uint32_t chan )
@@ -139,8 +363,9 @@ static void dwc2_channel_interrupt ( uint32_t chan )
     if ( hcint.ahberr || hcint.stall || hcint.xacterr || hcint.bblerr ||
             hcint.frmovrun || hcint.datatglerr )
     {
-        printu ( "A USB error occurred:" );
-        dwc2_channel_interrupt_display ( hcint );
+        /* hcint bits: 2 ahberr, 3 stall, 4 nak, 5 ack, 6 nyet, 7 xacterr,
+         * 8 bblerr, 9 frmovrun, 10 datatglerr */
+        klog_error ( "A USB error occurred: chan %u hcint %x", chan, hcint.raw );
         dwc2_complete_request ( chan, USB_STATUS_ERROR );
         return;
     }
@@ -322,6 +547,21 @@ static void dwc2_prepare_channel ( uint32_t chan )
     regs -> host.hc [ chan ].hctsiz = hctsiz;
     regs -> host.hc [ chan ].hcdma = ( uintptr_t ) hcdma;
 
+    // NAKed periodic IN transactions are retried by the FIQ
+    if ( hcchar.eptype == HCCHAR_EPTYPE_IRQ && hcchar.epdir == HCCHAR_EPDIR_IN )
+    {
+        uint32_t irqmask = fiq_disable ( );
+        struct dwc2_fiq_chan * fchan = & ( dwc2_fiq_chans [ chan ] );
+
+        // TODO: This is valid only for HS IRQ and ISOC endpoints
+        fchan -> interval = 1 << ( req -> endp -> bInterval - 1 );
+        fchan -> hctsiz = hctsiz;
+        fchan -> hcdma = ( uintptr_t ) hcdma;
+        fchan -> state = DWC2_FIQ_ACTIVE;
+
+        irq_restore ( irqmask );
+    }
+
     // Transmit!
     dwc2_start_channel ( chan );
 }
@@ -355,7 +595,7 @@ static void dwc2_real_request ( struct usb_request * req )
     dwc2_prepare_channel ( chan );
 }
 
-void dwc2_defer_req_thread ( struct usb_request * req )
+static void dwc2_defer_req ( struct usb_request * req )
 {
     uint32_t usec;
 
@@ -363,64 +603,60 @@ void dwc2_defer_req_thread ( struct usb_request * req )
     // TODO: This is valid only for HS IRQ and ISOC endpoints
     usec = ( 1 << ( req -> endp -> bInterval - 1 ) ) * 125;
 
-    // Defer
-    api_process_sleep ( usec );
+    uint32_t irqmask = irq_disable ( );
 
-    // Relaunch the request
-    dwc2_real_request ( req );
-}
+    req -> defer_date = systimer_get_clock ( ) + usec;
+    req -> next_deferred = dwc2_deferred_reqs;
+    dwc2_deferred_reqs = req;
 
-static void dwc2_defer_req ( struct usb_request * req )
-{
-    api_process_create ( dwc2_defer_req_thread, req );
+    irq_restore ( irqmask );
+
+    // Let the consumer thread take the new date into account
+    signal ( dwc2_deferred_sem );
 }
 
-#define NB_FIFOS 3
-struct fifos
+/*
+ * Relaunches the deferred requests whose date is reached.
+ * @return number of usec until the next deferred request is due
+ * (PCB_TIMEOUT_NONE if there is none).
+ */
+static uint32_t dwc2_relaunch_deferred ( )
 {
-    uint32_t * size;
-    uint32_t max;
-};
-typedef struct fifos fifos_t [ NB_FIFOS ];
+    struct usb_request * due = 0;
+    uint32_t timeout = PCB_TIMEOUT_NONE;
 
-static void resize_fifos ( fifos_t fifos, uint32_t remaining_space )
-{
-    uint32_t remaining_fifos = NB_FIFOS;
+    uint32_t irqmask = irq_disable ( );
+    uint32_t now = systimer_get_clock ( );
 
-    while ( remaining_space > 0 )
+    // Move due requests to our own list
+    struct usb_request * * it = &dwc2_deferred_reqs;
+    while ( * it )
     {
-        // Compute an equal share to give to every still-hungry FIFO
-        uint32_t equal_share = max ( remaining_space / remaining_fifos, 1 );
+        struct usb_request * req = * it;
 
-        for ( int i = 0 ; i < NB_FIFOS ; ++i )
+        if ( systimer_date_before ( now, req -> defer_date ) )
         {
-            uint32_t until_full = fifos [ i ].max - * ( fifos [ i ].size );
-
-            // Skip FIFO which has already eaten until full
-            if ( until_full == 0 )
-            {
-                continue;
-            }
-
-            // FIFO is still hungry: feed it
-            uint32_t eat = min ( equal_share, until_full );
-            * ( fifos [ i ].size ) += eat;
+            timeout = min ( timeout, req -> defer_date - now );
+            it = & ( req -> next_deferred );
+            continue;
+        }
 
-            // FIFO is satisfied and optimum
-            if ( * ( fifos [ i ].size ) == fifos [ i ].max )
-            {
-                remaining_fifos--;
-            }
+        * it = req -> next_deferred;
+        req -> next_deferred = due;
+        due = req;
+    }
 
-            remaining_space -= eat;
+    irq_restore ( irqmask );
 
-            // No food left! Good job! =) Wasting is not good...
-            if ( remaining_space == 0 )
-            {
-                break;
-            }
-        }
+    // Relaunch them (this may wait for a free channel)
+    while ( due )
+    {
+        struct usb_request * req = due;
+        due = req -> next_deferred;
+        dwc2_real_request ( req );
     }
+
+    return timeout;
 }
 
 static void dwc2_setup_fifos ( )
@@ -449,7 +685,7 @@ static void dwc2_setup_fifos ( )
             { & gnptxfsiz, hwcfg.gnptxf.siz },
             { & hptxfsiz, hwcfg.hptxf.siz },
         };
-        resize_fifos ( fifos, dfifodepth );
+        dwc2_resize_fifos ( fifos, dfifodepth );
     }
     // Else, just use the maximum size for each of them because it will fit!
     else
@@ -552,9 +788,11 @@ static void dwc2_setup_interrupts ( )
         regs -> core.gahbcfg = gahbcfg;
     }
 
-    // Route the top level interrupt to CPU
-    interrupt_handlers [ IRQ_USB_HCD ] = dwc2_interrupt;
-    pic_enable_irq ( IRQ_USB_HCD );
+    bh_setup ( &dwc2_bh, dwc2_bottom_half, 0 );
+
+    // Route the top level interrupt to CPU, through the FIQ fast path
+    pic_route_fiq ( IRQ_USB_HCD, dwc2_fiq, dwc2_interrupt, 0 );
+    pic_set_priority ( IRQ_USB_HCD, PIC_PRIO_LOW );
 }
 
 static void dwc2_reset ( )
@@ -632,34 +870,82 @@ static int dwc2_probe ( )
     return 1;
 }
 
+#define DWC2_CONSUMER_BATCH 8
+
 static void dwc2_usb_consumer_thread ( )
 {
+    struct usb_request * reqs [ DWC2_CONSUMER_BATCH ];
+
     for ( ; ; )
     {
-        struct usb_request * req =
-            ( void * ) ( long ) mailbox_recv ( usb_requests_mbox );
+        uint32_t ready;
+        uint32_t timeout = dwc2_relaunch_deferred ( );
 
-        if ( usb_dev_is_root ( req -> dev ) )
+        // Sleep until a request is submitted or a deferred one is due
+        if ( evset_wait ( dwc2_consumer_evset, &ready, timeout ) != 0 )
         {
-            dwc2_root_hub_request ( req );
+            continue;
         }
-        else
+
+        // Deferral dates are picked up on next loop
+        if ( ready & ( 1 << DWC2_EVENT_DEFERRED ) )
         {
-            dwc2_real_request ( req );
+            while ( wait_timeout ( dwc2_deferred_sem, 0 ) == 0 );
+        }
+
+        if ( ! ( ready & ( 1 << DWC2_EVENT_REQUEST ) ) )
+        {
+            continue;
+        }
+
+        // Fetch all pending requests at once
+        int n = msgq_recv_many_timeout ( usb_requests_msgq,
+                ( void * * ) reqs, DWC2_CONSUMER_BATCH, 0 );
+
+        for ( int i = 0 ; i < n ; ++i )
+        {
+            if ( usb_dev_is_root ( reqs [ i ] -> dev ) )
+            {
+                dwc2_root_hub_request ( reqs [ i ] );
+            }
+            else
+            {
+                dwc2_real_request ( reqs [ i ] );
+            }
         }
     }
 }
 
 static int dwc2_start_usb_consumer_thread ( )
 {
-    if ( ( usb_requests_mbox = mailbox_create ( 512 ) ) < 0 )
+    if ( ( usb_requests_msgq = msgq_create ( 512 ) ) < 0 )
     {
         return -1;
     }
 
     if ( ( dwc2_free_chan_sem = sem_create ( hwcfg.chancount ) ) < 0 )
     {
-        mailbox_destroy ( usb_requests_mbox );
+        msgq_destroy ( usb_requests_msgq );
+        return -1;
+    }
+
+    if ( ( dwc2_deferred_sem = sem_create ( 0 ) ) < 0 )
+    {
+        sem_destroy ( dwc2_free_chan_sem );
+        msgq_destroy ( usb_requests_msgq );
+        return -1;
+    }
+
+    if ( ( dwc2_consumer_evset = evset_create ( ) ) < 0
+        || evset_add_msgq ( dwc2_consumer_evset, usb_requests_msgq,
+                DWC2_EVENT_REQUEST ) != 0
+        || evset_add_sem ( dwc2_consumer_evset, dwc2_deferred_sem,
+                DWC2_EVENT_DEFERRED ) != 0 )
+    {
+        evset_destroy ( dwc2_consumer_evset );
+        sem_destroy ( dwc2_deferred_sem );
+        sem_destroy ( dwc2_free_chan_sem );
+        msgq_destroy ( usb_requests_msgq );
         return -1;
     }
 
@@ -705,5 +991,5 @@ void hcd_stop ( )
 
 void hcd_submit_request ( struct usb_request * req )
 {
-    mailbox_send ( usb_requests_mbox, ( intptr_t ) req );
+    msgq_send ( usb_requests_msgq, req );
 }
@@ -0,0 +1,42 @@
+#include "usb_dwc2_fifos.h"
+#include "../../libc/math.h"
+
+void dwc2_resize_fifos ( fifos_t fifos, uint32_t remaining_space )
+{
+    uint32_t remaining_fifos = NB_FIFOS;
+
+    while ( remaining_space > 0 )
+    {
+        // Compute an equal share to give to every still-hungry FIFO
+        uint32_t equal_share = max ( remaining_space / remaining_fifos, 1 );
+
+        for ( int i = 0 ; i < NB_FIFOS ; ++i )
+        {
+            uint32_t until_full = fifos [ i ].max - * ( fifos [ i ].size );
+
+            // Skip FIFO which has already eaten until full
+            if ( until_full == 0 )
+            {
+                continue;
+            }
+
+            // FIFO is still hungry: feed it
+            uint32_t eat = min ( equal_share, until_full );
+            * ( fifos [ i ].size ) += eat;
+
+            // FIFO is satisfied and optimum
+            if ( * ( fifos [ i ].size ) == fifos [ i ].max )
+            {
+                remaining_fifos--;
+            }
+
+            remaining_space -= eat;
+
+            // No food left! Good job! =) Wasting is not good...
+            if ( remaining_space == 0 )
+            {
+                break;
+            }
+        }
+    }
+}
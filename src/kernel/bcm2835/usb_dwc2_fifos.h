@@ -0,0 +1,25 @@
+#ifndef _H_USB_DWC2_FIFOS
+#define _H_USB_DWC2_FIFOS
+
+#include <stdint.h>
+
+/*
+ * RX, non-periodic TX and periodic TX FIFOs share the DFIFO RAM.
+ * size points to the size to compute, max is its power-on value which
+ * must never be exceeded.
+ */
+#define NB_FIFOS 3
+struct fifos
+{
+    uint32_t * size;
+    uint32_t max;
+};
+typedef struct fifos fifos_t [ NB_FIFOS ];
+
+/*
+ * Shares remaining_space between the FIFOs: equally, but never more than
+ * a FIFO's max. No hardware access.
+ */
+void dwc2_resize_fifos ( fifos_t fifos, uint32_t remaining_space );
+
+#endif
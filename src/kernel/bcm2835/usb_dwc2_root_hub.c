@@ -4,7 +4,9 @@
 #include "../usb_std_hub.h"
 
 #include "../arm.h"
-#include "uart.h"
+#include "../klog.h"
+
+#include "../../api/process.h"
 
 #include "../../libc/string.h"
 #include "../../libc/math.h"
@@ -107,7 +109,7 @@ static const struct usb_hub_desc dwc2_root_hub_hub_desc =
 
 void dwc2_root_hub_handle_port_interrupt ( )
 {
-    printuln ( "Interrupt (root port)" );
+    klog_debug ( "Interrupt (root port)" );
     union hprt hprt = regs -> host.hprt;
 
     // Update our port status for the USB Hub driver
@@ -158,8 +160,8 @@ static void dwc2_root_hub_reset_port ( )
     hprt.prtrst = 1;
     regs -> host.hprt = hprt;
 
-    // Wait the required delay
-    cdelay ( 50 * 1000 * 7 );
+    // Wait the required delay (this runs in the HCD thread: sleep)
+    api_process_msleep ( 50 );
 
     // De-assert reset on the port
     hprt.prtrst = 0;
@@ -332,6 +334,7 @@ static void dwc2_root_hub_interrupt_req ( )
     struct usb_request * req = dwc2_root_hub_pending_req;
     if ( ! req )
     {
+        irq_restore ( irqmask );
         return;
     }
     dwc2_root_hub_pending_req = 0;
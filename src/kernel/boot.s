@@ -63,6 +63,10 @@ fiq_addr:       .word fiq_handler
  * a reset exception occurs, where the CPU state will be known.
  * NOTE: Purposely jumping to this handler at 0x0 wouldn't reset the CPU... */
 reset_handler:
+    @ Switch to FIQ Mode, initialize FIQ stack pointer
+    cps #0x11
+    mov sp,#0x4000
+
     @ Switch to IRQ Mode, initialize IRQ stack pointer
     cps #0x12
     mov sp,#0x8000
@@ -96,5 +100,4 @@ undefined_handler:
 softirq_handler:
 prefetch_handler:
 data_handler:
-unused_handler:
-fiq_handler: b crash
+unused_handler: b crash
@@ -0,0 +1,95 @@
+#include "bottom_half.h"
+#include "pcb_turnstile.h"
+#include "scheduler.h"
+#include "arm.h"
+#include "bcm2835/pic.h"
+
+// Scheduled bottom halves, in scheduling order
+static struct bottom_half * bh_first;
+static struct bottom_half * bh_last;
+
+static kernel_pcb_t * bh_thread;
+
+// Whether bh_thread sleeps waiting for bottom halves
+static int bh_thread_waiting;
+
+static void bh_loop ( )
+{
+    for ( ; ; )
+    {
+        uint32_t irqmask = irq_disable ( );
+
+        struct bottom_half * bh = bh_first;
+        if ( ! bh )
+        {
+            // Nothing to do: sleep until bh_schedule wakes us up
+            bh_thread_waiting = 1;
+            pcb_turnstile_remove ( pcb_running, &turnstile_round_robin );
+            scheduler_yield ( );
+            irq_restore ( irqmask );
+            continue;
+        }
+
+        bh_first = bh -> next;
+        if ( ! bh_first )
+        {
+            bh_last = 0;
+        }
+
+        // Scheduling it again from now on means running it again
+        bh -> pending = 0;
+
+        irq_restore ( irqmask );
+
+        ( * bh -> func ) ( bh -> ctx );
+    }
+}
+
+void bh_init ( )
+{
+    bh_first = 0;
+    bh_last = 0;
+    bh_thread_waiting = 0;
+    bh_thread = pcb_create ( bh_loop, 0 );
+}
+
+void bh_setup ( struct bottom_half * bh, void ( * func ) ( void * ), void * ctx )
+{
+    bh -> func = func;
+    bh -> ctx = ctx;
+    bh -> next = 0;
+    bh -> pending = 0;
+}
+
+int bh_schedule ( struct bottom_half * bh )
+{
+    int ret = PIC_HANDLED;
+    uint32_t irqmask = irq_disable ( );
+
+    if ( ! bh -> pending )
+    {
+        bh -> pending = 1;
+        bh -> next = 0;
+
+        if ( bh_last )
+        {
+            bh_last -> next = bh;
+        }
+        else
+        {
+            bh_first = bh;
+        }
+        bh_last = bh;
+    }
+
+    // Run the thread right after the IRQ
+    if ( bh_thread_waiting )
+    {
+        bh_thread_waiting = 0;
+        pcb_turnstile_pushfront ( bh_thread, &turnstile_round_robin );
+        ret = PIC_RESCHEDULE;
+    }
+
+    irq_restore ( irqmask );
+    return ret;
+}
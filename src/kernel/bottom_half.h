@@ -0,0 +1,41 @@
+#ifndef _H_BOTTOM_HALF
+#define _H_BOTTOM_HALF
+
+#include <stdint.h>
+
+/*
+ * Bottom halves split interrupt handling in two. The top half, registered
+ * with the PIC, runs in IRQ context: it only acknowledges (or masks) the
+ * device and schedules its bottom half. Bottom halves run in a kernel thread,
+ * with IRQ enabled: they can be preempted, take time, print, and wake
+ * processes up like any process would.
+ *
+ * The bottom half thread is put at the head of the round robin when woken
+ * up: it runs as soon as the IRQ returns, before any other process.
+ */
+struct bottom_half
+{
+    void ( * func ) ( void * ctx );
+    void * ctx;
+
+    // Private
+    struct bottom_half * next;
+    int pending;
+};
+
+// Creates the bottom half thread
+void bh_init ( );
+
+// Initializes a bottom half, to run func ( ctx )
+void bh_setup ( struct bottom_half * bh, void ( * func ) ( void * ), void * ctx );
+
+/*
+ * Schedules a bottom half to run, if not already scheduled. It runs once,
+ * however many times it is scheduled before it starts.
+ * To be called from an interrupt handler, which should return the result.
+ * @return PIC_RESCHEDULE if the bottom half thread has to be elected,
+ * PIC_HANDLED otherwise.
+ */
+int bh_schedule ( struct bottom_half * bh );
+
+#endif
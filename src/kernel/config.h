@@ -7,4 +7,50 @@
 #define KERNEL_SCHEDULER_TIMER_CHANNEL 1
 #define KERNEL_SCHEDULER_TIMER_PERIOD 100000
 
+// Never program the scheduler timer closer than this (in microseconds)
+#define KERNEL_SCHEDULER_TIMER_MIN_DELAY 20
+
+// Pipes copy at most this many bytes per IRQ-off section
+#define KERNEL_PIPE_MAX_BATCH 512
+
+/* UART line rate, for the console and the telemetry frames (see telemetry.h).
+ * The UART clock is set by the firmware (init_uart_clock in config.txt) and
+ * must be at least 16 times the rate: raise both to go beyond 187500 bauds,
+ * e.g. 48000000 for 921600 or 3000000 bauds. */
+#define KERNEL_UART_CLOCK 3000000
+#define KERNEL_UART_BAUD_RATE 115200
+
+// UART output is queued in a ring of this many bytes (power of 2)
+#define KERNEL_UART_TX_RING_SIZE 4096
+
+// Received bytes wait in a ring of this many bytes (power of 2)
+#define KERNEL_UART_RX_RING_SIZE 256
+
+// Comment out to leave the IRQ path to the I-cache replacement (see icache.h)
+#define KERNEL_ICACHE_LOCK
+
+// Events counted from boot for each process (see pmu.h and "ps")
+#define KERNEL_PMU_EVENT0 PMU_EVENT_ICACHE_MISS
+#define KERNEL_PMU_EVENT1 PMU_EVENT_BRANCH_MISPREDICT
+
+// Comment out to disable the monitor shell on the UART (see monitor.h)
+#define KERNEL_MONITOR
+
+/* Log records of a lower level are compiled out (see klog.h):
+ * 0 errors, 1 warnings, 2 info, 3 debug */
+#define KERNEL_LOG_LEVEL 2
+
+// Records kept until the log thread prints them (power of 2)
+#define KERNEL_LOG_RING_SIZE 256
+
+// The log thread looks for new records this often (microseconds)
+#define KERNEL_LOG_FLUSH_PERIOD 20000
+
+/* Uncomment to measure how long IRQ stay disabled by irq_disable/irq_restore.
+ * The worst sections are reported on the UART every period (in microseconds).
+ * See irqoff_trace.h. */
+// #define KERNEL_TRACE_IRQOFF
+#define KERNEL_TRACE_IRQOFF_WORST 8
+#define KERNEL_TRACE_IRQOFF_PERIOD 10000000
+
 #endif
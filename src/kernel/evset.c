@@ -0,0 +1,282 @@
+#include "evset.h"
+#include "pcb_turnstile.h"
+#include "scheduler.h"
+#include "arm.h"
+#include "bcm2835/systimer.h"
+
+#define EVSET_NB 8
+
+enum
+{
+    EVSET_FREE,
+    EVSET_USED,
+};
+
+enum evset_source_type
+{
+    EVSET_SOURCE_SEM,
+    EVSET_SOURCE_MSGQ,
+};
+
+struct evset_source
+{
+    enum evset_source_type type;
+    int handle;
+};
+
+struct evset_s
+{
+    int state;
+
+    // Bitmask of the registered ids
+    uint32_t used;
+    struct evset_source sources [ EVSET_MAX_SOURCES ];
+
+    // Processes blocked in evset_wait
+    kernel_pcb_turnstile_t waitq;
+};
+
+static struct evset_s evsets [ EVSET_NB ];
+
+static struct evset_s * evset_get ( evset_t set )
+{
+    // Bound check
+    if ( set < 0 || set >= EVSET_NB )
+    {
+        return 0;
+    }
+
+    return & ( evsets [ set ] );
+}
+
+// Attach (or detach with set -1) an event set to a source
+static int evset_source_attach ( struct evset_source * src, evset_t set )
+{
+    switch ( src -> type )
+    {
+        case EVSET_SOURCE_SEM:
+            return sem_set_evset ( src -> handle, set );
+        case EVSET_SOURCE_MSGQ:
+            return msgq_set_evset ( src -> handle, set );
+        default:
+            return -1;
+    }
+}
+
+static int evset_source_ready ( struct evset_source * src )
+{
+    switch ( src -> type )
+    {
+        case EVSET_SOURCE_SEM:
+            return sem_count ( src -> handle ) > 0;
+        case EVSET_SOURCE_MSGQ:
+            return msgq_count ( src -> handle ) > 0;
+        default:
+            return 0;
+    }
+}
+
+// ASSERT: IRQ have to be disabled prior to call.
+static uint32_t evset_poll ( struct evset_s * pset )
+{
+    uint32_t ready = 0;
+    uint32_t ids = pset -> used;
+
+    while ( ids )
+    {
+        uint32_t id = 31 - __builtin_clz ( ids );
+        ids ^= ( 1 << id );
+
+        if ( evset_source_ready ( & ( pset -> sources [ id ] ) ) )
+        {
+            ready |= ( 1 << id );
+        }
+    }
+
+    return ready;
+}
+
+void evset_init ( )
+{
+    for ( int i = 0 ; i < EVSET_NB ; ++i )
+    {
+        evsets [ i ].state = EVSET_FREE;
+        pcb_turnstile_init ( & ( evsets [ i ].waitq ) );
+    }
+}
+
+evset_t evset_create ( )
+{
+    uint32_t irqmask = irq_disable ( );
+
+    for ( int i = 0 ; i < EVSET_NB ; ++i )
+    {
+        if ( evsets [ i ].state == EVSET_FREE )
+        {
+            evsets [ i ].state = EVSET_USED;
+            evsets [ i ].used = 0;
+            irq_restore ( irqmask );
+            return i;
+        }
+    }
+
+    irq_restore ( irqmask );
+    return -1;
+}
+
+void evset_destroy ( evset_t set )
+{
+    struct evset_s * pset = evset_get ( set );
+    if ( ! pset )
+    {
+        return;
+    }
+
+    uint32_t irqmask = irq_disable ( );
+
+    if ( pset -> state == EVSET_FREE )
+    {
+        irq_restore ( irqmask );
+        return;
+    }
+
+    // Detach all sources
+    for ( int id = 0 ; id < EVSET_MAX_SOURCES ; ++id )
+    {
+        evset_remove ( set, id );
+    }
+
+    pset -> state = EVSET_FREE;
+
+    // Release waiting processes: they will notice the set is gone
+    while ( pcb_wakeup ( & ( pset -> waitq ) ) );
+
+    irq_restore ( irqmask );
+}
+
+static int evset_add ( evset_t set, enum evset_source_type type, int handle,
+        int id )
+{
+    struct evset_s * pset = evset_get ( set );
+    if ( ! pset || id < 0 || id >= EVSET_MAX_SOURCES )
+    {
+        return -1;
+    }
+
+    uint32_t irqmask = irq_disable ( );
+
+    if ( pset -> state != EVSET_USED || ( pset -> used & ( 1 << id ) ) )
+    {
+        irq_restore ( irqmask );
+        return -1;
+    }
+
+    struct evset_source * src = & ( pset -> sources [ id ] );
+    src -> type = type;
+    src -> handle = handle;
+
+    if ( evset_source_attach ( src, set ) != 0 )
+    {
+        irq_restore ( irqmask );
+        return -1;
+    }
+
+    pset -> used |= ( 1 << id );
+
+    irq_restore ( irqmask );
+    return 0;
+}
+
+int evset_add_sem ( evset_t set, sem_t sem, int id )
+{
+    return evset_add ( set, EVSET_SOURCE_SEM, sem, id );
+}
+
+int evset_add_mailbox ( evset_t set, mailbox_t mbox, int id )
+{
+    // A mailbox holds a message whenever its receiver semaphore can be taken
+    return evset_add ( set, EVSET_SOURCE_SEM, mailbox_get_recv_sem ( mbox ), id );
+}
+
+int evset_add_msgq ( evset_t set, msgq_t q, int id )
+{
+    return evset_add ( set, EVSET_SOURCE_MSGQ, q, id );
+}
+
+void evset_remove ( evset_t set, int id )
+{
+    struct evset_s * pset = evset_get ( set );
+    if ( ! pset || id < 0 || id >= EVSET_MAX_SOURCES )
+    {
+        return;
+    }
+
+    uint32_t irqmask = irq_disable ( );
+
+    if ( pset -> used & ( 1 << id ) )
+    {
+        evset_source_attach ( & ( pset -> sources [ id ] ), -1 );
+        pset -> used ^= ( 1 << id );
+    }
+
+    irq_restore ( irqmask );
+}
+
+int evset_wait ( evset_t set, uint32_t * ready, uint32_t timeout )
+{
+    struct evset_s * pset = evset_get ( set );
+    if ( ! pset )
+    {
+        return -1;
+    }
+
+    uint32_t deadline = systimer_get_clock ( ) + timeout;
+    uint32_t irqmask = irq_disable ( );
+
+    for ( ; ; )
+    {
+        if ( pset -> state != EVSET_USED )
+        {
+            irq_restore ( irqmask );
+            return -1;
+        }
+
+        uint32_t ready_ = evset_poll ( pset );
+        if ( ready_ )
+        {
+            * ready = ready_;
+            irq_restore ( irqmask );
+            return 0;
+        }
+
+        // Another process may have consumed the event we were woken up for:
+        // only wait for what remains of the timeout
+        uint32_t left = timeout;
+        if ( timeout != PCB_TIMEOUT_NONE )
+        {
+            left = deadline - systimer_get_clock ( );
+            if ( ( int32_t ) left < 0 )
+            {
+                left = 0;
+            }
+        }
+
+        if ( pcb_block ( pcb_running, & ( pset -> waitq ), left ) != 0 )
+        {
+            irq_restore ( irqmask );
+            return -1;
+        }
+    }
+}
+
+void evset_notify ( evset_t set )
+{
+    struct evset_s * pset = evset_get ( set );
+    if ( ! pset || pset -> state != EVSET_USED )
+    {
+        return;
+    }
+
+    // Let all waiters check which sources are ready
+    while ( pcb_wakeup ( & ( pset -> waitq ) ) );
+}
@@ -0,0 +1,58 @@
+#ifndef _H_EVSET
+#define _H_EVSET
+
+#include <stdint.h>
+#include "semaphore.h"
+#include "mailbox.h"
+#include "msgq.h"
+#include "pcb.h"
+
+typedef int evset_t;
+
+#define EVSET_MAX_SOURCES 32
+
+/*
+ * An event set lets one process block on several semaphores, mailboxes and
+ * message queues at once. Each source is registered with an id (0 to
+ * EVSET_MAX_SOURCES - 1). evset_wait returns a bitmask of the ids of the
+ * ready sources:
+ * - a semaphore is ready when wait_timeout ( sem, 0 ) would succeed ;
+ * - a mailbox or a message queue is ready when it holds a message.
+ *
+ * Readiness is level-triggered: the process then consumes events with the
+ * non-blocking calls of each source, and an event not consumed keeps its
+ * source ready. A source can belong to one event set at a time, and must
+ * outlive its membership.
+ */
+
+void evset_init ( );
+
+evset_t evset_create ( );
+void evset_destroy ( evset_t set );
+
+/*
+ * Registers a source in the set under id.
+ * @return 0 on success, -1 on error (invalid id or source, id already in
+ * use, source already in another set).
+ */
+int evset_add_sem ( evset_t set, sem_t sem, int id );
+int evset_add_mailbox ( evset_t set, mailbox_t mbox, int id );
+int evset_add_msgq ( evset_t set, msgq_t q, int id );
+
+// Unregisters source id from the set
+void evset_remove ( evset_t set, int id );
+
+/*
+ * Blocks until at least one source of the set is ready, or until timeout
+ * microseconds have elapsed (PCB_TIMEOUT_NONE to wait forever).
+ * @return 0 and the ready ids bitmask in ready, -1 on error or timeout.
+ */
+int evset_wait ( evset_t set, uint32_t * ready, uint32_t timeout );
+
+/*
+ * Called by the sources when they may have become ready.
+ * ASSERT: IRQ have to be disabled prior to call.
+ */
+void evset_notify ( evset_t set );
+
+#endif
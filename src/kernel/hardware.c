@@ -2,10 +2,14 @@
 #include "bcm2835/power.h"
 #include "bcm2835/pic.h"
 #include "bcm2835/uart.h"
+#include "bcm2835/dma.h"
 #include "bcm2835/systimer.h"
 #include "bcm2835/gpio.h"
 #include "usb_core.h"
+#include "icache.h"
+#include "pmu.h"
 #include "pcb.h"
+#include "arm.h"
 
 static inline void hardware_led_init ( );
 
@@ -17,6 +21,14 @@ void hardware_init ( )
     // Make sure no FIQ or IRQ will be generated by the PIC
     pic_disable_all_interrupts ( );
 
+    // Cycle counter, used to measure the cost of interrupt handlers
+    pmu_init ( );
+
+    // Before any IRQ: the IRQ path is locked into the I-cache, see icache.h
+    icache_init ( );
+
+    dma_init ( );
+
     uart_init ( );
     printuln ( "Welcome!" );
 
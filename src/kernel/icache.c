@@ -0,0 +1,27 @@
+#include "icache.h"
+#include "arm.h"
+
+// Bounds of .text.hot, set by the linker script
+extern char _text_hot_start [ ];
+extern char _text_hot_end [ ];
+
+void icache_init ( )
+{
+    arm_icache_enable ( );
+
+#ifdef KERNEL_ICACHE_LOCK
+    icache_lock_hot ( );
+#endif
+}
+
+uint32_t icache_lock_hot ( )
+{
+    arm_icache_lock ( _text_hot_start, _text_hot_end, ICACHE_LOCK_WAY );
+
+    return _text_hot_end - _text_hot_start;
+}
+
+void icache_unlock ( )
+{
+    arm_icache_set_lockdown ( ICACHE_LOCKDOWN_NONE );
+}
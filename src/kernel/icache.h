@@ -0,0 +1,42 @@
+#ifndef _H_KERNEL_ICACHE
+#define _H_KERNEL_ICACHE
+
+#include <stdint.h>
+#include "config.h"
+
+/*
+ * The ARM1176 L1 instruction cache is 16 KB: 4 ways of 4 KB, with 32-byte
+ * lines. The code every interrupt goes through (the entry in irq.s,
+ * irq_dispatch, scheduler_handler, scheduler_ctxsw and the helpers they call
+ * each time) is linked contiguously in the .text.hot section, at most one
+ * way large (make/kernel.ld). Locked into a way, it can't be evicted by the
+ * code running between interrupts, which is left the other 3 ways.
+ * The data cache can't be used with the MMU off, so there is nothing to lock
+ * on the data side.
+ */
+
+#define ICACHE_LOCK_WAY 0
+
+// Lockdown register value with no way locked (bits 31:4 should be one)
+#define ICACHE_LOCKDOWN_NONE 0xfffffff0
+
+// Links a function into .text.hot
+#define ICACHE_HOT __attribute__ (( section ( ".text.hot" ) ))
+
+/*
+ * Enables the I-cache, then locks .text.hot into it unless configured out
+ * (KERNEL_ICACHE_LOCK).
+ * ASSERT: to be called before IRQ are enabled.
+ */
+void icache_init ( );
+
+/*
+ * Loads .text.hot into way ICACHE_LOCK_WAY, and locks the way.
+ * @return the number of bytes locked.
+ */
+uint32_t icache_lock_hot ( );
+
+// Gives the locked way back to the normal replacement
+void icache_unlock ( );
+
+#endif
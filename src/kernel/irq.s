@@ -1,4 +1,7 @@
 @ vim: ft=arm
+/* Run by every interrupt: locked into the I-cache, see icache.h */
+.section .text.hot, "ax", %progbits
+
 .globl irq_handler
 irq_handler:
 	// Correct lr_irq value due to the ARM pipeline design
@@ -11,10 +14,15 @@ irq_handler:
     cps #0x13
 	stmfd sp!, { r0 - r12, lr }
 
-    // Retrieve sp_svc to r0. Then switch back to IRQ mode.
-    // r0 isn't banked: we gain access to sp_svc from IRQ mode.
+    /* Dispatch in SVC mode: handlers run with IRQ enabled, and a nested IRQ
+     * would otherwise overwrite lr_irq. The context of the interrupted code
+     * (process or handler) stays on its own stack. */
     mov r0, sp
-    cps #0x12
+
+    // We're going to call an external interface
+    // Make sure sp is 8-bytes aligned
+    and r1, sp, #4
+    sub sp, sp, r1
 
     // r0 contain the old stack
 
@@ -22,10 +30,28 @@ irq_handler:
 
     // r0 Contain the new stack to load
 
-    // Switch back to SVC mode
-    cps #0x13
-
 	// Restore current process context (Pop r0 - r12, lr)
     mov sp, r0
 	ldmfd sp!, { r0 - r12, lr }
+
+    /* The process may have been preempted between ldrex and strex (see
+     * atomic_cas): its strex must fail, even if another process left the
+     * exclusive monitor open meanwhile */
+    clrex
 	rfefd sp!
+
+.text
+
+/* FIQ mode banks r8 - r12: only the registers the C code may clobber are
+ * saved (r12 is only here to keep sp 8-bytes aligned). The handler runs in
+ * FIQ mode, on its own stack, and never switches process. */
+.globl fiq_handler
+fiq_handler:
+	// Correct lr_fiq value due to the ARM pipeline design
+	sub lr, lr, #4
+	stmfd sp!, { r0 - r3, r12, lr }
+
+    bl fiq_dispatch
+
+	// Return to the interrupted code, restoring cpsr from spsr_fiq
+	ldmfd sp!, { r0 - r3, r12, pc }^
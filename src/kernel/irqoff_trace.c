@@ -0,0 +1,180 @@
+#include "arm.h"
+
+#ifdef KERNEL_TRACE_IRQOFF
+
+#include "irqoff_trace.h"
+#include "bcm2835/systimer.h"
+#include "bcm2835/uart.h"
+
+#include "../api/process.h"
+
+// Current section
+static int irqoff_active;
+static uint32_t irqoff_start;
+static uintptr_t irqoff_caller;
+
+// Worst sections, worst first
+static struct irqoff_trace_entry irqoff_worst [ KERNEL_TRACE_IRQOFF_WORST ];
+static uint32_t irqoff_nb;
+
+// Call site of the function calling us
+#define irqoff_call_site() \
+    ( ( uintptr_t ) __builtin_return_address ( 0 ) - 4 )
+
+/*
+ * Ends the current section and ranks it.
+ * ASSERT: IRQ have to be disabled prior to call.
+ */
+static void irqoff_trace_end ( uintptr_t restore_caller )
+{
+    uint32_t duration = systimer_get_clock ( ) - irqoff_start;
+    uint32_t i;
+
+    irqoff_active = 0;
+
+    // One entry per irq_disable call site
+    for ( i = 0 ; i < irqoff_nb ; ++i )
+    {
+        if ( irqoff_worst [ i ].disable_caller == irqoff_caller )
+        {
+            break;
+        }
+    }
+
+    if ( i == irqoff_nb )
+    {
+        // Not among the worst ones
+        if ( irqoff_nb == KERNEL_TRACE_IRQOFF_WORST )
+        {
+            if ( duration <= irqoff_worst [ irqoff_nb - 1 ].worst )
+            {
+                return;
+            }
+
+            i = irqoff_nb - 1;
+        }
+        else
+        {
+            i = irqoff_nb++;
+        }
+
+        irqoff_worst [ i ].disable_caller = irqoff_caller;
+        irqoff_worst [ i ].worst = 0;
+        irqoff_worst [ i ].count = 0;
+    }
+
+    irqoff_worst [ i ].count++;
+
+    if ( duration < irqoff_worst [ i ].worst )
+    {
+        return;
+    }
+
+    irqoff_worst [ i ].worst = duration;
+    irqoff_worst [ i ].restore_caller = restore_caller;
+
+    // Keep the list sorted
+    while ( i > 0 && irqoff_worst [ i - 1 ].worst < duration )
+    {
+        struct irqoff_trace_entry tmp = irqoff_worst [ i - 1 ];
+        irqoff_worst [ i - 1 ] = irqoff_worst [ i ];
+        irqoff_worst [ i ] = tmp;
+        --i;
+    }
+}
+
+uint32_t irqoff_trace_disable ( )
+{
+    uint32_t cpsr = ( irq_disable ) ( );
+
+    // Outermost section only
+    if ( ! ( cpsr & ARM_CPSR_IRQ_MASK ) )
+    {
+        irqoff_active = 1;
+        irqoff_caller = irqoff_call_site ( );
+        irqoff_start = systimer_get_clock ( );
+    }
+
+    return cpsr;
+}
+
+void irqoff_trace_restore ( uint32_t cpsr )
+{
+    if ( irqoff_active && ! ( cpsr & ARM_CPSR_IRQ_MASK ) )
+    {
+        irqoff_trace_end ( irqoff_call_site ( ) );
+    }
+
+    ( irq_restore ) ( cpsr );
+}
+
+void irqoff_trace_switch ( uint32_t cpsr )
+{
+    // The elected process resumes with IRQ enabled: the section ends here
+    if ( irqoff_active && ! ( cpsr & ARM_CPSR_IRQ_MASK ) )
+    {
+        irqoff_trace_end ( irqoff_call_site ( ) );
+    }
+}
+
+uint32_t irqoff_trace_get ( struct irqoff_trace_entry * entries, uint32_t n )
+{
+    uint32_t irqmask = ( irq_disable ) ( );
+
+    if ( n > irqoff_nb )
+    {
+        n = irqoff_nb;
+    }
+
+    for ( uint32_t i = 0 ; i < n ; ++i )
+    {
+        entries [ i ] = irqoff_worst [ i ];
+    }
+
+    ( irq_restore ) ( irqmask );
+    return n;
+}
+
+void irqoff_trace_reset ( )
+{
+    uint32_t irqmask = ( irq_disable ) ( );
+    irqoff_nb = 0;
+    ( irq_restore ) ( irqmask );
+}
+
+void irqoff_trace_dump ( )
+{
+    struct irqoff_trace_entry entries [ KERNEL_TRACE_IRQOFF_WORST ];
+    uint32_t n = irqoff_trace_get ( entries, KERNEL_TRACE_IRQOFF_WORST );
+
+    printuln ( "IRQ-off worst sections (disable -> restore: worst usec, count):" );
+
+    for ( uint32_t i = 0 ; i < n ; ++i )
+    {
+        printu ( "  " );
+        printu_32h ( entries [ i ].disable_caller );
+        printu ( " -> " );
+        printu_32h ( entries [ i ].restore_caller );
+        printu ( ": " );
+        printu_32d ( entries [ i ].worst );
+        printu ( ", " );
+        printu_32d ( entries [ i ].count );
+        printuln ( 0 );
+    }
+}
+
+static void irqoff_trace_reporter ( )
+{
+    for ( ; ; )
+    {
+        api_process_sleep ( KERNEL_TRACE_IRQOFF_PERIOD );
+        irqoff_trace_dump ( );
+    }
+}
+
+void irqoff_trace_init ( )
+{
+    api_process_create ( irqoff_trace_reporter, 0 );
+}
+
+#endif
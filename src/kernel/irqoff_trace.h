@@ -0,0 +1,46 @@
+#ifndef _H_IRQOFF_TRACE
+#define _H_IRQOFF_TRACE
+
+#include <stdint.h>
+
+/*
+ * IRQ-off sections tracer, enabled with KERNEL_TRACE_IRQOFF (see config.h).
+ *
+ * irq_disable and irq_restore are then redirected here. A section starts when
+ * irq_disable is called with IRQ enabled, and ends when IRQ are enabled back:
+ * by irq_restore, or by a context switch to a process running with IRQ
+ * enabled. Nested sections are part of the outermost one.
+ *
+ * The worst KERNEL_TRACE_IRQOFF_WORST sections are kept, one per irq_disable
+ * call site.
+ */
+
+struct irqoff_trace_entry
+{
+    uintptr_t disable_caller;   // irq_disable call site
+    uintptr_t restore_caller;   // irq_restore call site of the worst section
+    uint32_t worst;             // Worst duration (microseconds)
+    uint32_t count;             // Sections traced since it entered the list
+};
+
+// Starts the reporter process
+void irqoff_trace_init ( );
+
+uint32_t irqoff_trace_disable ( );
+void irqoff_trace_restore ( uint32_t cpsr );
+
+// Called by the scheduler before switching to a process with cpsr
+void irqoff_trace_switch ( uint32_t cpsr );
+
+/*
+ * Copies up to n worst sections to entries, worst first.
+ * @return number of entries copied.
+ */
+uint32_t irqoff_trace_get ( struct irqoff_trace_entry * entries, uint32_t n );
+
+void irqoff_trace_reset ( );
+
+// Prints the worst sections on the UART
+void irqoff_trace_dump ( );
+
+#endif
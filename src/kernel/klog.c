@@ -0,0 +1,201 @@
+#include "klog.h"
+#include "pcb.h"
+#include "scheduler.h"
+#include "arm.h"
+#include "bcm2835/systimer.h"
+#include "bcm2835/uart.h"
+
+#define KLOG_RING_MASK ( KERNEL_LOG_RING_SIZE - 1 )
+
+struct klog_record
+{
+    // Reservation number + 1, set once the record is complete
+    volatile uint32_t seq;
+
+    const char * fmt;
+    uint32_t date;
+    uint32_t level;
+    uint32_t nargs;
+    uint32_t args [ KLOG_MAX_ARGS ];
+};
+
+static struct klog_record klog_ring [ KERNEL_LOG_RING_SIZE ];
+
+/* Writers reserve records by incrementing head (compare-and-swap), the log
+ * thread frees them by incrementing tail. Both are free running counters. */
+static volatile uint32_t klog_head;
+static volatile uint32_t klog_tail;
+
+static volatile uint32_t klog_nb_dropped;
+
+static const char klog_levels [ ] = { 'E', 'W', 'I', 'D' };
+
+void klog_write ( uint32_t level, const char * fmt, const uint32_t * args,
+        uint32_t nargs )
+{
+    uint32_t idx;
+
+    do
+    {
+        idx = klog_head;
+
+        if ( idx - klog_tail >= KERNEL_LOG_RING_SIZE )
+        {
+            uint32_t dropped;
+            do
+            {
+                dropped = klog_nb_dropped;
+            } while ( atomic_cas ( &klog_nb_dropped, dropped, dropped + 1 ) != dropped );
+
+            return;
+        }
+    } while ( atomic_cas ( &klog_head, idx, idx + 1 ) != idx );
+
+    struct klog_record * rec = & ( klog_ring [ idx & KLOG_RING_MASK ] );
+
+    if ( nargs > KLOG_MAX_ARGS )
+    {
+        nargs = KLOG_MAX_ARGS;
+    }
+
+    rec -> fmt = fmt;
+    rec -> date = systimer_get_clock ( );
+    rec -> level = level;
+    rec -> nargs = nargs;
+    for ( uint32_t i = 0 ; i < nargs ; ++i )
+    {
+        rec -> args [ i ] = args [ i ];
+    }
+
+    // Publish: the record must be complete before the log thread sees it
+    dmb ( );
+    rec -> seq = idx + 1;
+}
+
+static void klog_print ( struct klog_record * rec )
+{
+    uint32_t arg = 0;
+
+    printu ( "[" );
+    printu_32d ( rec -> date );
+    printu ( "] " );
+
+    char prefix [ 4 ] = { klog_levels [ rec -> level & 3 ], ':', ' ', '\0' };
+    printu ( prefix );
+
+    for ( const char * f = rec -> fmt ; * f ; ++f )
+    {
+        char c [ 2 ] = { * f, '\0' };
+
+        if ( * f != '%' || ! f [ 1 ] )
+        {
+            printu ( c );
+            continue;
+        }
+
+        f++;
+        uint32_t val = ( arg < rec -> nargs ) ? rec -> args [ arg ] : 0;
+
+        switch ( * f )
+        {
+            case 'd':
+                if ( ( int32_t ) val < 0 )
+                {
+                    printu ( "-" );
+                    val = - val;
+                }
+                printu_32d ( val );
+                arg++;
+                break;
+
+            case 'u':
+                printu_32d ( val );
+                arg++;
+                break;
+
+            case 'x':
+                printu_32h ( val );
+                arg++;
+                break;
+
+            case 'c':
+                c [ 0 ] = val;
+                printu ( c );
+                arg++;
+                break;
+
+            case 's':
+                printu ( val ? ( const char * ) val : "(null)" );
+                arg++;
+                break;
+
+            default:
+                c [ 0 ] = * f;
+                printu ( c );
+                break;
+        }
+    }
+
+    printuln ( 0 );
+}
+
+// @return 1 if a record was printed, 0 if there is none (complete) yet
+static int klog_print_next ( )
+{
+    struct klog_record * slot = & ( klog_ring [ klog_tail & KLOG_RING_MASK ] );
+
+    if ( slot -> seq != klog_tail + 1 )
+    {
+        return 0;
+    }
+
+    // Copy it, so that the slot can be reused while we print
+    struct klog_record rec = * slot;
+
+    dmb ( );
+    klog_tail++;
+
+    klog_print ( &rec );
+    return 1;
+}
+
+void klog_flush ( )
+{
+    while ( klog_print_next ( ) );
+}
+
+uint32_t klog_dropped ( )
+{
+    return klog_nb_dropped;
+}
+
+static void klog_loop ( )
+{
+    uint32_t reported = 0;
+
+    for ( ; ; )
+    {
+        klog_flush ( );
+
+        uint32_t dropped = klog_nb_dropped;
+        if ( dropped != reported )
+        {
+            printu ( "klog: records dropped: " );
+            printu_32d ( dropped - reported );
+            printuln ( 0 );
+            reported = dropped;
+        }
+
+        uint32_t irqmask = irq_disable ( );
+        pcb_sleep ( pcb_running, KERNEL_LOG_FLUSH_PERIOD );
+        irq_restore ( irqmask );
+    }
+}
+
+void klog_init ( )
+{
+    klog_head = 0;
+    klog_tail = 0;
+    klog_nb_dropped = 0;
+    pcb_create ( klog_loop, 0 );
+}
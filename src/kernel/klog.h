@@ -0,0 +1,75 @@
+#ifndef _H_KLOG
+#define _H_KLOG
+
+#include <stdint.h>
+#include "config.h"
+
+/*
+ * Deferred kernel log. Logging only stores a binary record (format string
+ * address, arguments, date and level) in a ring, which is lock-free and safe
+ * from any context, FIQ included. The log thread formats and prints records
+ * later, in order. Records are dropped (and counted) when the ring is full.
+ *
+ * Format strings must be literals: only their address is stored. Arguments
+ * are 32-bit integers, at most KLOG_MAX_ARGS. Conversions: %d %u %x %c %s %%
+ * (%s arguments must point to strings that outlive the record, cast them
+ * with KLOG_PTR).
+ *
+ * Levels above KERNEL_LOG_LEVEL are compiled out, arguments are not even
+ * evaluated: debug logs cost nothing in hot paths.
+ */
+
+#define KLOG_ERROR  0
+#define KLOG_WARN   1
+#define KLOG_INFO   2
+#define KLOG_DEBUG  3
+
+#define KLOG_MAX_ARGS 4
+
+#define KLOG_PTR(p) ( ( uint32_t ) ( p ) )
+
+#define klog(level, fmt, ...) \
+    do \
+    { \
+        const uint32_t klog_args_ [ ] = { 0, ##__VA_ARGS__ }; \
+        klog_write ( level, fmt, klog_args_ + 1, \
+                sizeof ( klog_args_ ) / sizeof ( uint32_t ) - 1 ); \
+    } while ( 0 )
+
+#define klog_error(fmt, ...) klog ( KLOG_ERROR, fmt, ##__VA_ARGS__ )
+
+#if KERNEL_LOG_LEVEL >= KLOG_WARN
+#define klog_warn(fmt, ...) klog ( KLOG_WARN, fmt, ##__VA_ARGS__ )
+#else
+#define klog_warn(fmt, ...) do { } while ( 0 )
+#endif
+
+#if KERNEL_LOG_LEVEL >= KLOG_INFO
+#define klog_info(fmt, ...) klog ( KLOG_INFO, fmt, ##__VA_ARGS__ )
+#else
+#define klog_info(fmt, ...) do { } while ( 0 )
+#endif
+
+#if KERNEL_LOG_LEVEL >= KLOG_DEBUG
+#define klog_debug(fmt, ...) klog ( KLOG_DEBUG, fmt, ##__VA_ARGS__ )
+#else
+#define klog_debug(fmt, ...) do { } while ( 0 )
+#endif
+
+// Starts the log thread
+void klog_init ( );
+
+// Stores a record, use the klog_* macros instead
+void klog_write ( uint32_t level, const char * fmt, const uint32_t * args,
+        uint32_t nargs );
+
+/*
+ * Prints all pending records right away, e.g. before a crash loop.
+ * ASSERT: not to be called concurrently with the log thread (IRQ disabled).
+ */
+void klog_flush ( );
+
+// Number of records dropped because the ring was full
+uint32_t klog_dropped ( );
+
+#endif
@@ -2,8 +2,7 @@
 #include "semaphore.h"
 #include "memory.h"
 #include "arm.h"
-
-#define MAILBOX_NB 8
+#include "pcb.h"
 
 enum
 {
@@ -124,6 +123,18 @@ void mailbox_destroy ( mailbox_t mbox )
 }
 
 int mailbox_recv ( mailbox_t mbox )
+{
+    int msg;
+
+    if ( mailbox_recv_timeout ( mbox, &msg, PCB_TIMEOUT_NONE ) != 0 )
+    {
+        return -1;
+    }
+
+    return msg;
+}
+
+int mailbox_recv_timeout ( mailbox_t mbox, int * msg, uint32_t timeout )
 {
     // Bound check
     if ( mbox < 0 || mbox >= MAILBOX_NB )
@@ -141,7 +152,11 @@ int mailbox_recv ( mailbox_t mbox )
         return -1;
     }
 
-    wait ( pmbox -> recv_sem );
+    if ( wait_timeout ( pmbox -> recv_sem, timeout ) != 0 )
+    {
+        irq_restore ( irqmask );
+        return -1;
+    }
 
     // Recheck whether mailbox still exists
     if ( pmbox -> state != MAILBOX_USED )
@@ -151,7 +166,7 @@ int mailbox_recv ( mailbox_t mbox )
     }
 
     // Retrieve message and update mailbox
-    int msg = pmbox -> data [ pmbox -> first ];
+    * msg = pmbox -> data [ pmbox -> first ];
     pmbox -> first = ( pmbox -> first + 1 ) % pmbox -> capacity;
     pmbox -> count--;
 
@@ -159,7 +174,7 @@ int mailbox_recv ( mailbox_t mbox )
     signal ( pmbox -> send_sem );
 
     irq_restore ( irqmask );
-    return msg;
+    return 0;
 }
 
 int mailbox_send ( mailbox_t mbox, int msg )
@@ -198,3 +213,44 @@ int mailbox_send ( mailbox_t mbox, int msg )
     irq_restore ( irqmask );
     return 0;
 }
+
+sem_t mailbox_get_recv_sem ( mailbox_t mbox )
+{
+    // Bound check
+    if ( mbox < 0 || mbox >= MAILBOX_NB )
+    {
+        return -1;
+    }
+
+    if ( mailboxes [ mbox ].state != MAILBOX_USED )
+    {
+        return -1;
+    }
+
+    return mailboxes [ mbox ].recv_sem;
+}
+
+int mailbox_occupancy ( mailbox_t mbox, uint32_t * count, uint32_t * capacity )
+{
+    // Bound check
+    if ( mbox < 0 || mbox >= MAILBOX_NB )
+    {
+        return -1;
+    }
+
+    uint32_t irqmask = irq_disable ( );
+
+    struct mailbox_s * pmbox = & ( mailboxes [ mbox ] );
+
+    if ( pmbox -> state != MAILBOX_USED )
+    {
+        irq_restore ( irqmask );
+        return -1;
+    }
+
+    * count = pmbox -> count;
+    * capacity = pmbox -> capacity;
+
+    irq_restore ( irqmask );
+    return 0;
+}
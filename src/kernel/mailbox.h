@@ -2,9 +2,13 @@
 #define _H_MAILBOX
 
 #include <stdint.h>
+#include "semaphore.h"
 
 typedef int mailbox_t;
 
+// Mailboxes are numbered from 0 to MAILBOX_NB - 1
+#define MAILBOX_NB 8
+
 void mailbox_init ( );
 
 mailbox_t mailbox_create ( uint32_t capacity );
@@ -13,5 +17,25 @@ void mailbox_destroy ( mailbox_t mbox );
 int mailbox_recv ( mailbox_t mbox );
 int mailbox_send ( mailbox_t mbox, int msg );
 
+/*
+ * Receives a message into msg, giving up after timeout microseconds
+ * (PCB_TIMEOUT_NONE to wait forever).
+ * @return 0 on success, -1 on error or if the timeout expired.
+ */
+int mailbox_recv_timeout ( mailbox_t mbox, int * msg, uint32_t timeout );
+
+/*
+ * Semaphore counting the messages held by the mailbox. Used by the event
+ * sets to wait on mailboxes, see evset.h.
+ * @return the semaphore, -1 on error.
+ */
+sem_t mailbox_get_recv_sem ( mailbox_t mbox );
+
+/*
+ * Fetches the number of messages held by the mailbox, and its capacity.
+ * @return 0 on success, -1 if the mailbox doesn't exist.
+ */
+int mailbox_occupancy ( mailbox_t mbox, uint32_t * count, uint32_t * capacity );
+
 
 #endif
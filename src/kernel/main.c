@@ -2,8 +2,15 @@
 #include "hardware.h"
 #include "semaphore.h"
 #include "mailbox.h"
+#include "msgq.h"
+#include "evset.h"
+#include "pipe.h"
 #include "scheduler.h"
 #include "pcb.h"
+#include "bottom_half.h"
+#include "monitor.h"
+#include "klog.h"
+#include "arm.h"
 #include "bcm2835/uart.h"
 
 void init ( );
@@ -16,11 +23,24 @@ void kernel_main ( uint32_t z, uint32_t mach, uint32_t atags )
 
     sem_init ( );
     mailbox_init ( );
+    msgq_init ( );
+    evset_init ( );
+    pipe_init ( );
 
     scheduler_init ( );
+    bh_init ( );
+    klog_init ( );
 
     hardware_init ( );
 
+#ifdef KERNEL_TRACE_IRQOFF
+    irqoff_trace_init ( );
+#endif
+
+#ifdef KERNEL_MONITOR
+    monitor_init ( );
+#endif
+
     printuln ( "Bootup sequence complete! Yielding CPU to userspace..." );
     pcb_create ( init, 0 );
     scheduler_reschedule ( 0 );
@@ -28,6 +48,8 @@ void kernel_main ( uint32_t z, uint32_t mach, uint32_t atags )
 
 void crash ( )
 {
+    klog_flush ( );
     printuln ( "CRASH" );
+    uart_flush ( );
     for ( ; ; );
 }
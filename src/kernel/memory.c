@@ -1,6 +1,7 @@
 #include "memory.h"
 #include "config.h"
 #include "arm.h"
+#include "bcm2835/systimer.h"
 
 /*
  * @infos: Kernel heap structure
@@ -26,6 +27,27 @@ unsigned char * kernel_memory_heap;
 static void * KERNEL_HEAP_ADDR_MIN;
 static void * KERNEL_HEAP_ADDR_MAX;
 
+// Longest IRQ-off section of the heap, in CPU cycles and in microseconds
+static uint32_t memory_worst_irqoff;
+static uint32_t memory_worst_irqoff_us;
+
+// ASSERT: IRQ have to be disabled prior to call, since start (cycles, us)
+static void memory_account_irqoff ( uint32_t start, uint32_t start_us )
+{
+	uint32_t cycles = arm_get_cycle_count ( ) - start;
+	uint32_t us = systimer_get_clock ( ) - start_us;
+
+	if ( cycles > memory_worst_irqoff )
+	{
+		memory_worst_irqoff = cycles;
+	}
+
+	if ( us > memory_worst_irqoff_us )
+	{
+		memory_worst_irqoff_us = us;
+	}
+}
+
 
 
 void memory_init ( )
@@ -53,7 +75,7 @@ void memory_init ( )
 void * memory_allocate ( uint32_t size )
 {
 	// Overflow check
-	if ( size >= ( ~0 - sizeof ( kernel_heap_part_t ) ) )
+	if ( size >= ( UINT32_MAX - sizeof ( kernel_heap_part_t ) ) )
 	{
 		return 0;
 	}
@@ -62,6 +84,8 @@ void * memory_allocate ( uint32_t size )
 	size = ( size + 3 ) & ~3;
 
     uint32_t irqmask = irq_disable ( );
+	uint32_t start = arm_get_cycle_count ( );
+	uint32_t start_us = systimer_get_clock ( );
 	kernel_heap_part_t * current = ( kernel_heap_part_t * ) kernel_memory_heap;
 	while ( current -> mpNext )
 	{
@@ -70,8 +94,8 @@ void * memory_allocate ( uint32_t size )
 		if
 		(
 			(
-				( ( uint32_t ) current -> mpNext ) -
-				( ( uint32_t ) ( ( char * ) ( current + 1 ) ) + current -> mSize )
+				( ( uintptr_t ) current -> mpNext ) -
+				( ( uintptr_t ) ( ( char * ) ( current + 1 ) ) + current -> mSize )
 			)
 			>=
 			(
@@ -80,6 +104,7 @@ void * memory_allocate ( uint32_t size )
 		)
 		{
 			kernel_heap_part_t * new = memory_private_allocate ( size, current );
+			memory_account_irqoff ( start, start_us );
             irq_restore ( irqmask );
 			return new + 1;
 		}
@@ -88,6 +113,7 @@ void * memory_allocate ( uint32_t size )
 	}
 
 	// We didn't find any space :'(
+	memory_account_irqoff ( start, start_us );
     irq_restore ( irqmask );
 	return 0;
 }
@@ -101,6 +127,8 @@ void memory_deallocate ( void * address )
 	}
 
     uint32_t irqmask = irq_disable ( );
+	uint32_t start = arm_get_cycle_count ( );
+	uint32_t start_us = systimer_get_clock ( );
 
 	// We get the kernel memory header pointer
 	kernel_heap_part_t * heap_part_head = &( ( ( kernel_heap_part_t * ) address ) [ -1 ] );
@@ -117,6 +145,60 @@ void memory_deallocate ( void * address )
 	heap_part_head -> mpPrevious -> mpNext = heap_part_head -> mpNext;
 	heap_part_head -> mpNext -> mpPrevious = heap_part_head -> mpPrevious;
 
+	memory_account_irqoff ( start, start_us );
+    irq_restore ( irqmask );
+}
+
+void memory_get_stats ( struct memory_stats * stats )
+{
+	stats -> used_blocks = 0;
+	stats -> used_bytes = 0;
+	stats -> free_bytes = 0;
+	stats -> largest_free = 0;
+	stats -> free_holes = 0;
+
+    uint32_t irqmask = irq_disable ( );
+
+	stats -> worst_irqoff_cycles = memory_worst_irqoff;
+	stats -> worst_irqoff_us = memory_worst_irqoff_us;
+
+	kernel_heap_part_t * current = ( kernel_heap_part_t * ) kernel_memory_heap;
+	while ( current -> mpNext )
+	{
+		// Head has no user space, others are allocated blocks
+		if ( current != ( kernel_heap_part_t * ) kernel_memory_heap )
+		{
+			stats -> used_blocks++;
+			stats -> used_bytes += current -> mSize;
+		}
+
+		// Same computation as memory_allocate
+		uint32_t hole =
+			( ( uintptr_t ) current -> mpNext ) -
+			( ( uintptr_t ) ( ( char * ) ( current + 1 ) ) + current -> mSize );
+
+		if ( hole )
+		{
+			stats -> free_holes++;
+			stats -> free_bytes += hole;
+
+			if ( hole > stats -> largest_free )
+			{
+				stats -> largest_free = hole;
+			}
+		}
+
+		current = current -> mpNext;
+	}
+
+    irq_restore ( irqmask );
+}
+
+void memory_reset_stats ( )
+{
+    uint32_t irqmask = irq_disable ( );
+	memory_worst_irqoff = 0;
+	memory_worst_irqoff_us = 0;
     irq_restore ( irqmask );
 }
 
@@ -38,4 +38,44 @@ void * memory_allocate ( uint32_t size );
  */
 void memory_deallocate ( void * address );
 
+
+
+/*
+ * @infos: Heap usage snapshot
+ *
+ * @members:
+ * - used_blocks, used_bytes: allocated blocks and their user size
+ * - free_bytes: total size of the holes between blocks (headers included)
+ * - largest_free: largest hole, an allocation needs a header on top of it
+ * - free_holes: number of holes
+ * - worst_irqoff_cycles: longest time (CPU cycles) the heap kept IRQ
+ *   disabled in a single allocation or de-allocation
+ * - worst_irqoff_us: the same in microseconds, from the system timer (the
+ *   cycle counter is not emulated by QEMU)
+ */
+struct memory_stats
+{
+	uint32_t used_blocks;
+	uint32_t used_bytes;
+	uint32_t free_bytes;
+	uint32_t largest_free;
+	uint32_t free_holes;
+	uint32_t worst_irqoff_cycles;
+	uint32_t worst_irqoff_us;
+};
+
+/*
+ * @infos: Walks the heap to fill stats. IRQ are disabled meanwhile.
+ *
+ * @return: void
+ */
+void memory_get_stats ( struct memory_stats * stats );
+
+/*
+ * @infos: Resets worst_irqoff_cycles and worst_irqoff_us
+ *
+ * @return: void
+ */
+void memory_reset_stats ( );
+
 #endif
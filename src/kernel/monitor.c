@@ -0,0 +1,315 @@
+#include "monitor.h"
+#include "pcb.h"
+#include "scheduler.h"
+#include "memory.h"
+#include "pmu.h"
+#include "semaphore.h"
+#include "mailbox.h"
+#include "usb_core.h"
+#include "usb_hub.h"
+#include "config.h"
+#include "arm.h"
+#include "bcm2835/uart.h"
+#include "bcm2835/pic.h"
+#include "bcm2835/watchdog.h"
+
+#define MONITOR_LINE_SIZE 64
+#define MONITOR_MAX_PCBS 32
+
+#define MONITOR_KEY_BACKSPACE 0x08
+#define MONITOR_KEY_DELETE 0x7f
+
+struct monitor_cmd
+{
+    const char * name;
+    const char * help;
+    void ( * func ) ( );
+};
+
+static int monitor_streq ( const char * a, const char * b )
+{
+    while ( * a && * a == * b )
+    {
+        a++;
+        b++;
+    }
+
+    return * a == * b;
+}
+
+static void monitor_print_field ( const char * name, uint32_t val )
+{
+    printu ( " " );
+    printu ( name );
+    printu ( "=" );
+    printu_32d ( val );
+}
+
+static void monitor_ps ( )
+{
+    static struct pcb_info infos [ MONITOR_MAX_PCBS ];
+
+    uint32_t n = pcb_snapshot ( infos, MONITOR_MAX_PCBS - 1 );
+
+    // The idle process is not part of the list
+    kernel_pcb_t * idle = scheduler_get_idle ( );
+    infos [ n ].pid = idle -> mPid;
+    infos [ n ].entry = idle -> mpEntry;
+    infos [ n ].cpu_time = idle -> mCpuTime;
+    pmu_read ( idle, & ( infos [ n ].pmu ) );
+    infos [ n ].running = ( idle == pcb_running );
+    infos [ n ].blocked = 0;
+    n++;
+
+    uint64_t total = 0;
+    for ( uint32_t i = 0 ; i < n ; ++i )
+    {
+        total += infos [ i ].cpu_time;
+    }
+
+    // Events counted, as in pmu.h
+    uint32_t event0, event1;
+    int started = pmu_get_events ( &event0, &event1 );
+
+    printu ( "pmu" );
+    monitor_print_field ( "event0", event0 );
+    monitor_print_field ( "event1", event1 );
+    printuln ( started ? " counting" : " stopped" );
+
+    printuln ( "pid entry kcycles cpu% event0 event1 state" );
+
+    for ( uint32_t i = 0 ; i < n ; ++i )
+    {
+        printu_32d ( infos [ i ].pid );
+        printu ( " " );
+        printu_32h ( ( uint32_t ) infos [ i ].entry );
+        printu ( " " );
+        printu_32d ( infos [ i ].cpu_time / 1000 );
+        printu ( " " );
+        printu_32d ( total ? ( infos [ i ].cpu_time * 100 ) / total : 0 );
+        printu ( " " );
+        printu_32d ( infos [ i ].pmu.event0 );
+        printu ( " " );
+        printu_32d ( infos [ i ].pmu.event1 );
+        printuln ( infos [ i ].running ? " running" :
+                ( infos [ i ].blocked ? " blocked" : " ready/sleeping" ) );
+    }
+}
+
+static void monitor_heap ( )
+{
+    struct memory_stats stats;
+    memory_get_stats ( &stats );
+
+    printu ( "heap" );
+    monitor_print_field ( "used_blocks", stats.used_blocks );
+    monitor_print_field ( "used_bytes", stats.used_bytes );
+    monitor_print_field ( "free_bytes", stats.free_bytes );
+    monitor_print_field ( "largest_free", stats.largest_free );
+    monitor_print_field ( "free_holes", stats.free_holes );
+    monitor_print_field ( "worst_irqoff_cycles", stats.worst_irqoff_cycles );
+    monitor_print_field ( "worst_irqoff_us", stats.worst_irqoff_us );
+    printuln ( 0 );
+}
+
+static void monitor_irq ( )
+{
+    struct pic_irq_stats stats;
+
+    for ( int irq = 0 ; irq < IRQ_NUMBER ; ++irq )
+    {
+        if ( pic_get_irq_stats ( irq, &stats ) != 0 || stats.count == 0 )
+        {
+            continue;
+        }
+
+        printu ( "irq" );
+        monitor_print_field ( "num", irq );
+        monitor_print_field ( "count", stats.count );
+        monitor_print_field ( "kcycles", stats.cycles / 1000 );
+        printuln ( 0 );
+    }
+}
+
+static void monitor_usb_device ( struct usb_device * dev )
+{
+    // Indent by depth in the tree
+    for ( struct usb_device * it = dev -> parent ; it ; it = it -> parent )
+    {
+        printu ( "  " );
+    }
+
+    printu ( "usb" );
+    monitor_print_field ( "addr", dev -> addr );
+    printu ( " id=" );
+    printu_32h ( dev -> dev_desc.idVendor );
+    printu ( ":" );
+    printu_32h ( dev -> dev_desc.idProduct );
+    monitor_print_field ( "class", dev -> dev_desc.bDeviceClass );
+    printuln ( dev -> hub ? " hub" : 0 );
+}
+
+static void monitor_usb ( )
+{
+    // Children are listed before their hub
+    if ( usb_foreach_root ( monitor_usb_device ) != 0 )
+    {
+        printuln ( "No USB host controller" );
+    }
+}
+
+static void monitor_ipc ( )
+{
+    for ( int i = 0 ; i < SEM_MAX ; ++i )
+    {
+        if ( ! sem_used ( i ) )
+        {
+            continue;
+        }
+
+        // Negative count: number of waiting processes
+        int count = sem_count ( i );
+
+        printu ( "sem" );
+        monitor_print_field ( "id", i );
+        printu ( count < 0 ? " count=-" : " count=" );
+        printu_32d ( count < 0 ? -count : count );
+        printuln ( 0 );
+    }
+
+    for ( int i = 0 ; i < MAILBOX_NB ; ++i )
+    {
+        uint32_t count, capacity;
+
+        if ( mailbox_occupancy ( i, &count, &capacity ) != 0 )
+        {
+            continue;
+        }
+
+        printu ( "mailbox" );
+        monitor_print_field ( "id", i );
+        monitor_print_field ( "count", count );
+        monitor_print_field ( "capacity", capacity );
+        printuln ( 0 );
+    }
+}
+
+static void monitor_uart ( )
+{
+    printu ( "uart" );
+    monitor_print_field ( "dropped", uart_get_dropped ( ) );
+    printuln ( 0 );
+}
+
+#ifdef KERNEL_TRACE_IRQOFF
+static void monitor_irqoff ( )
+{
+    irqoff_trace_dump ( );
+}
+#endif
+
+static void monitor_reset ( )
+{
+    uart_flush ( );
+    watchdog_start ( 1 );
+    for ( ; ; );
+}
+
+static void monitor_help ( );
+
+static const struct monitor_cmd monitor_cmds [ ] =
+{
+    { "help", "list commands", monitor_help },
+    { "ps", "processes, their CPU time and PMU counts", monitor_ps },
+    { "heap", "heap usage and fragmentation", monitor_heap },
+    { "irq", "interrupt counts and time", monitor_irq },
+    { "usb", "USB device tree", monitor_usb },
+    { "ipc", "semaphore and mailbox occupancy", monitor_ipc },
+    { "uart", "console output dropped during DMA transfers", monitor_uart },
+#ifdef KERNEL_TRACE_IRQOFF
+    { "irqoff", "worst IRQ-off sections", monitor_irqoff },
+#endif
+    { "reset", "reset the board", monitor_reset },
+};
+
+#define MONITOR_NB_CMDS ( sizeof ( monitor_cmds ) / sizeof ( monitor_cmds [ 0 ] ) )
+
+static void monitor_help ( )
+{
+    for ( uint32_t i = 0 ; i < MONITOR_NB_CMDS ; ++i )
+    {
+        printu ( monitor_cmds [ i ].name );
+        printu ( ": " );
+        printuln ( monitor_cmds [ i ].help );
+    }
+}
+
+// Reads a line, with echo. @return its length.
+static uint32_t monitor_read_line ( char * line )
+{
+    uint32_t len = 0;
+
+    for ( ; ; )
+    {
+        char c = uart_read_char ( );
+
+        if ( c == '\r' || c == '\n' )
+        {
+            printuln ( 0 );
+            line [ len ] = '\0';
+            return len;
+        }
+
+        if ( c == MONITOR_KEY_BACKSPACE || c == MONITOR_KEY_DELETE )
+        {
+            if ( len )
+            {
+                len--;
+                printu ( "\b \b" );
+            }
+            continue;
+        }
+
+        // Keep room for the terminating null byte
+        if ( len < MONITOR_LINE_SIZE - 1 && c >= ' ' )
+        {
+            line [ len++ ] = c;
+
+            char echo [ 2 ] = { c, '\0' };
+            printu ( echo );
+        }
+    }
+}
+
+static void monitor_loop ( )
+{
+    char line [ MONITOR_LINE_SIZE ];
+
+    for ( ; ; )
+    {
+        if ( monitor_read_line ( line ) )
+        {
+            uint32_t i = 0;
+            for ( ; i < MONITOR_NB_CMDS ; ++i )
+            {
+                if ( monitor_streq ( line, monitor_cmds [ i ].name ) )
+                {
+                    monitor_cmds [ i ].func ( );
+                    break;
+                }
+            }
+
+            if ( i == MONITOR_NB_CMDS )
+            {
+                printuln ( "Unknown command, try help" );
+            }
+        }
+
+        printu ( "> " );
+    }
+}
+
+void monitor_init ( )
+{
+    pcb_create ( monitor_loop, 0 );
+}
@@ -0,0 +1,13 @@
+#ifndef _H_MONITOR
+#define _H_MONITOR
+
+/*
+ * Monitor shell on the UART, to inspect a running board without a debugger.
+ * Enabled with KERNEL_MONITOR (see config.h). It stays silent until a line
+ * is typed; "help" lists the commands.
+ */
+
+// Starts the shell process. To be called once the UART is set up.
+void monitor_init ( );
+
+#endif
@@ -0,0 +1,301 @@
+#include "msgq.h"
+#include "pcb_turnstile.h"
+#include "scheduler.h"
+#include "memory.h"
+#include "arm.h"
+#include "evset.h"
+
+#define MSGQ_NB 8
+
+enum
+{
+    MSGQ_FREE,
+    MSGQ_USED,
+};
+
+struct msgq_s
+{
+    int state;
+
+    uint32_t count;
+    uint32_t first;
+    uint32_t capacity;
+
+    // Processes waiting for a message (recv) or for free room (send)
+    kernel_pcb_turnstile_t recv_waitq;
+    kernel_pcb_turnstile_t send_waitq;
+
+    void * * data;
+
+    // Event set to notify when messages arrive (-1 if none)
+    evset_t evset;
+};
+
+static struct msgq_s msgqs [ MSGQ_NB ];
+
+/*
+ * Blocks the running process on waitq until someone wakes it up.
+ * ASSERT: IRQ have to be disabled prior to call.
+ */
+static void msgq_block ( kernel_pcb_turnstile_t * waitq )
+{
+    pcb_block ( pcb_running, waitq, PCB_TIMEOUT_NONE );
+}
+
+/*
+ * Makes up to n processes waiting on waitq ready again.
+ * ASSERT: IRQ have to be disabled prior to call.
+ */
+static void msgq_wake ( kernel_pcb_turnstile_t * waitq, uint32_t n )
+{
+    while ( n-- && pcb_wakeup ( waitq ) );
+}
+
+static struct msgq_s * msgq_get ( msgq_t q )
+{
+    // Bound check
+    if ( q < 0 || q >= MSGQ_NB )
+    {
+        return 0;
+    }
+
+    return & ( msgqs [ q ] );
+}
+
+void msgq_init ( )
+{
+    for ( int i = 0 ; i < MSGQ_NB ; ++i )
+    {
+        msgqs [ i ].state = MSGQ_FREE;
+        pcb_turnstile_init ( & ( msgqs [ i ].recv_waitq ) );
+        pcb_turnstile_init ( & ( msgqs [ i ].send_waitq ) );
+    }
+}
+
+msgq_t msgq_create ( uint32_t capacity )
+{
+    if ( capacity == 0 )
+    {
+        return -1;
+    }
+
+    void * * data = memory_allocate ( capacity * sizeof ( void * ) );
+    if ( ! data )
+    {
+        return -1;
+    }
+
+    uint32_t irqmask = irq_disable ( );
+
+    for ( int i = 0 ; i < MSGQ_NB ; ++i )
+    {
+        struct msgq_s * pq = & ( msgqs [ i ] );
+
+        if ( pq -> state != MSGQ_FREE )
+        {
+            continue;
+        }
+
+        pq -> state = MSGQ_USED;
+        pq -> count = 0;
+        pq -> first = 0;
+        pq -> capacity = capacity;
+        pq -> data = data;
+        pq -> evset = -1;
+
+        irq_restore ( irqmask );
+        return i;
+    }
+
+    irq_restore ( irqmask );
+
+    memory_deallocate ( data );
+    return -1;
+}
+
+void msgq_destroy ( msgq_t q )
+{
+    struct msgq_s * pq = msgq_get ( q );
+    if ( ! pq )
+    {
+        return;
+    }
+
+    uint32_t irqmask = irq_disable ( );
+
+    // Nothing to do
+    if ( pq -> state == MSGQ_FREE )
+    {
+        irq_restore ( irqmask );
+        return;
+    }
+
+    pq -> state = MSGQ_FREE;
+    memory_deallocate ( pq -> data );
+
+    // Release waiting processes: they will notice the queue is gone
+    msgq_wake ( & ( pq -> recv_waitq ), ~0 );
+    msgq_wake ( & ( pq -> send_waitq ), ~0 );
+
+    irq_restore ( irqmask );
+}
+
+int msgq_send_many ( msgq_t q, void * const * msgs, uint32_t n )
+{
+    struct msgq_s * pq = msgq_get ( q );
+    if ( ! pq )
+    {
+        return -1;
+    }
+
+    uint32_t sent = 0;
+    uint32_t irqmask = irq_disable ( );
+
+    // Checked even for n == 0, so that it fails like msgq_recv_many
+    if ( pq -> state != MSGQ_USED )
+    {
+        irq_restore ( irqmask );
+        return -1;
+    }
+
+    while ( sent < n )
+    {
+        /* Destroyed while blocked: the messages sent so far are gone with
+         * the queue, the caller still owns msgs [ sent ] onwards */
+        if ( pq -> state != MSGQ_USED )
+        {
+            irq_restore ( irqmask );
+            return sent ? ( int ) sent : -1;
+        }
+
+        // Queue is full: wait for a receiver to make room
+        if ( pq -> count == pq -> capacity )
+        {
+            msgq_block ( & ( pq -> send_waitq ) );
+            continue;
+        }
+
+        // Move as many messages as there is room for
+        uint32_t batch = pq -> capacity - pq -> count;
+        if ( batch > n - sent )
+        {
+            batch = n - sent;
+        }
+
+        uint32_t last = pq -> first + pq -> count;
+        for ( uint32_t i = 0 ; i < batch ; ++i )
+        {
+            pq -> data [ ( last + i ) % pq -> capacity ] = msgs [ sent + i ];
+        }
+        pq -> count += batch;
+        sent += batch;
+
+        // One wakeup for the whole batch
+        msgq_wake ( & ( pq -> recv_waitq ), batch );
+
+        if ( pq -> evset >= 0 )
+        {
+            evset_notify ( pq -> evset );
+        }
+    }
+
+    irq_restore ( irqmask );
+    return sent;
+}
+
+int msgq_recv_many ( msgq_t q, void * * msgs, uint32_t n )
+{
+    return msgq_recv_many_timeout ( q, msgs, n, PCB_TIMEOUT_NONE );
+}
+
+int msgq_recv_many_timeout ( msgq_t q, void * * msgs, uint32_t n,
+        uint32_t timeout )
+{
+    struct msgq_s * pq = msgq_get ( q );
+    if ( ! pq )
+    {
+        return -1;
+    }
+
+    uint32_t irqmask = irq_disable ( );
+
+    for ( ; ; )
+    {
+        if ( pq -> state != MSGQ_USED )
+        {
+            irq_restore ( irqmask );
+            return -1;
+        }
+
+        // Nothing asked for: don't wait for anything
+        if ( pq -> count || n == 0 )
+        {
+            break;
+        }
+
+        // Queue is empty: wait for a sender
+        if ( pcb_block ( pcb_running, & ( pq -> recv_waitq ), timeout ) != 0 )
+        {
+            irq_restore ( irqmask );
+            return -1;
+        }
+    }
+
+    // Move all available messages (up to n)
+    uint32_t batch = ( pq -> count < n ) ? pq -> count : n;
+    for ( uint32_t i = 0 ; i < batch ; ++i )
+    {
+        msgs [ i ] = pq -> data [ pq -> first ];
+        pq -> first = ( pq -> first + 1 ) % pq -> capacity;
+    }
+    pq -> count -= batch;
+
+    // One wakeup for the whole batch
+    msgq_wake ( & ( pq -> send_waitq ), batch );
+
+    irq_restore ( irqmask );
+    return batch;
+}
+
+int msgq_send ( msgq_t q, void * msg )
+{
+    return ( msgq_send_many ( q, &msg, 1 ) == 1 ) ? 0 : -1;
+}
+
+int msgq_recv ( msgq_t q, void * * msg )
+{
+    return ( msgq_recv_many ( q, msg, 1 ) == 1 ) ? 0 : -1;
+}
+
+uint32_t msgq_count ( msgq_t q )
+{
+    struct msgq_s * pq = msgq_get ( q );
+    if ( ! pq || pq -> state != MSGQ_USED )
+    {
+        return 0;
+    }
+
+    return pq -> count;
+}
+
+int msgq_set_evset ( msgq_t q, int set )
+{
+    struct msgq_s * pq = msgq_get ( q );
+    if ( ! pq )
+    {
+        return -1;
+    }
+
+    uint32_t irqmask = irq_disable ( );
+
+    if ( pq -> state != MSGQ_USED || ( set >= 0 && pq -> evset >= 0 ) )
+    {
+        irq_restore ( irqmask );
+        return -1;
+    }
+
+    pq -> evset = set;
+
+    irq_restore ( irqmask );
+    return 0;
+}
@@ -0,0 +1,69 @@
+#ifndef _H_MSGQ
+#define _H_MSGQ
+
+#include <stdint.h>
+
+typedef int msgq_t;
+
+/*
+ * Message queues carry pointers to buffers of any size. Sending a message
+ * transfers the ownership of the buffer to the receiver: nothing is copied,
+ * and the sender must not touch the buffer anymore once it has been sent.
+ */
+
+void msgq_init ( );
+
+msgq_t msgq_create ( uint32_t capacity );
+void msgq_destroy ( msgq_t q );
+
+/*
+ * Sends one message. Blocks while the queue is full.
+ * @return 0 on success, -1 if the queue doesn't exist (anymore).
+ */
+int msgq_send ( msgq_t q, void * msg );
+
+/*
+ * Receives one message into msg. Blocks while the queue is empty.
+ * @return 0 on success, -1 if the queue doesn't exist (anymore).
+ */
+int msgq_recv ( msgq_t q, void * * msg );
+
+/*
+ * Sends n messages. As many messages as there is free room for are moved at
+ * once, within a single IRQ-off section and with a single wakeup of the
+ * receivers. Blocks until all n messages have been sent.
+ * @return number of messages sent, -1 if the queue doesn't exist. If the
+ * queue is destroyed while blocked, the number of messages sent until then
+ * (the caller still owns the others), or -1 if none was.
+ * n == 0 returns 0 right away (-1 if the queue doesn't exist).
+ */
+int msgq_send_many ( msgq_t q, void * const * msgs, uint32_t n );
+
+/*
+ * Receives up to n messages. Blocks until at least one message is available,
+ * then moves all available messages (up to n) at once, within a single IRQ-off
+ * section and with a single wakeup of the senders.
+ * @return number of messages received, -1 if the queue doesn't exist.
+ * n == 0 returns 0 right away (-1 if the queue doesn't exist).
+ */
+int msgq_recv_many ( msgq_t q, void * * msgs, uint32_t n );
+
+/*
+ * Same as msgq_recv_many, but gives up after timeout microseconds
+ * (0 not to block at all).
+ * @return number of messages received, -1 on error or if the timeout expired.
+ */
+int msgq_recv_many_timeout ( msgq_t q, void * * msgs, uint32_t n,
+        uint32_t timeout );
+
+// Number of messages currently in the queue
+uint32_t msgq_count ( msgq_t q );
+
+/*
+ * Attaches the queue to an event set (or detaches it with set -1).
+ * Used by the event sets only, see evset.h.
+ * @return 0 on success, -1 on error or if already attached.
+ */
+int msgq_set_evset ( msgq_t q, int set );
+
+#endif
@@ -7,6 +7,13 @@
 
 static void pcb_bigbang ( void * ( * f ) ( void * ), void * args );
 
+// PCBs in a timed wait, sorted by mWakeUpDate (nearest first)
+static kernel_pcb_t * pcb_timeouts;
+
+// All processes, latest first
+static kernel_pcb_t * pcb_list;
+static uint32_t pcb_next_pid = 1;
+
 kernel_pcb_t * pcb_create ( void * f, void * args )
 {
     kernel_pcb_t * pcb = memory_allocate ( sizeof ( kernel_pcb_t ) );
@@ -14,21 +21,66 @@ kernel_pcb_t * pcb_create ( void * f, void * args )
     pcb -> mpSP = ( pcb -> mpStack ) + KERNEL_STACK_SIZE - 16;
     pcb -> mpSP [ cpsr ] = ( arm_get_cpsr ( ) & ~ARM_MODE_MASK ) | ARM_MODE_SVC;
     pcb_enable_irq ( pcb );
+    pcb_enable_fiq ( pcb );
     pcb_set_register ( pcb, pc, pcb_bigbang );
     pcb_set_register ( pcb, r0, f );
     pcb_set_register ( pcb, r1, args );
 
+    pcb -> mPid = pcb_next_pid++;
+    pcb -> mpEntry = f;
+    pcb -> mCpuTime = 0;
+    pcb -> mPmuGeneration = 0;
+    pcb -> mpWaitQueue = 0;
+
+    uint32_t irqmask = irq_disable ( );
+    pcb -> mpNextAll = pcb_list;
+    pcb_list = pcb;
     pcb_turnstile_pushback ( pcb, &turnstile_round_robin );
+    irq_restore ( irqmask );
 
     return pcb;
 }
 
+static void pcb_list_remove ( kernel_pcb_t * pcb )
+{
+    for ( kernel_pcb_t * * it = &pcb_list ; * it ;
+            it = & ( ( * it ) -> mpNextAll ) )
+    {
+        if ( * it == pcb )
+        {
+            * it = pcb -> mpNextAll;
+            return;
+        }
+    }
+}
+
+uint32_t pcb_snapshot ( struct pcb_info * infos, uint32_t n )
+{
+    uint32_t i = 0;
+    uint32_t irqmask = irq_disable ( );
+
+    for ( kernel_pcb_t * pcb = pcb_list ; pcb && i < n ; pcb = pcb -> mpNextAll )
+    {
+        infos [ i ].pid = pcb -> mPid;
+        infos [ i ].entry = pcb -> mpEntry;
+        infos [ i ].cpu_time = pcb -> mCpuTime;
+        pmu_read ( pcb, & ( infos [ i ].pmu ) );
+        infos [ i ].running = ( pcb == pcb_running );
+        infos [ i ].blocked = ( pcb -> mpWaitQueue != 0 );
+        i++;
+    }
+
+    irq_restore ( irqmask );
+    return i;
+}
+
 void pcb_bigbang ( void * ( * f ) ( void * ), void * args )
 {
     f ( args );
 
     irq_disable ( );
     pcb_turnstile_remove ( pcb_running, &turnstile_round_robin );
+    pcb_list_remove ( pcb_running );
     memory_deallocate ( pcb_running -> mpStack );
     memory_deallocate ( pcb_running );
 
@@ -36,9 +88,14 @@ void pcb_bigbang ( void * ( * f ) ( void * ), void * args )
 }
 
 void pcb_sleep ( kernel_pcb_t * pcb, uint32_t duration )
+{
+	pcb_sleep_until ( pcb, systimer_get_clock ( ) + duration );
+}
+
+void pcb_sleep_until ( kernel_pcb_t * pcb, uint32_t date )
 {
 	pcb_turnstile_remove ( pcb, &turnstile_round_robin );
-	pcb -> mWakeUpDate = systimer_get_clock ( ) + duration;
+	pcb -> mWakeUpDate = date;
 	pcb_turnstile_sorted_insert ( pcb, &turnstile_sleeping );
 
 	if ( pcb == pcb_running )
@@ -46,3 +103,99 @@ void pcb_sleep ( kernel_pcb_t * pcb, uint32_t duration )
 		scheduler_yield ( );
 	}
 }
+
+static void pcb_timeout_insert ( kernel_pcb_t * pcb )
+{
+    kernel_pcb_t * * it = &pcb_timeouts;
+
+    while ( * it && ! systimer_date_before ( pcb -> mWakeUpDate, ( * it ) -> mWakeUpDate ) )
+    {
+        it = & ( ( * it ) -> mpNextTimeout );
+    }
+
+    pcb -> mpNextTimeout = * it;
+    * it = pcb;
+}
+
+static void pcb_timeout_remove ( kernel_pcb_t * pcb )
+{
+    for ( kernel_pcb_t * * it = &pcb_timeouts ; * it ;
+            it = & ( ( * it ) -> mpNextTimeout ) )
+    {
+        if ( * it == pcb )
+        {
+            * it = pcb -> mpNextTimeout;
+            return;
+        }
+    }
+}
+
+int pcb_block ( kernel_pcb_t * pcb, kernel_pcb_turnstile_t * waitq,
+        uint32_t timeout )
+{
+    if ( timeout == 0 )
+    {
+        return -1;
+    }
+
+    pcb_turnstile_remove ( pcb, &turnstile_round_robin );
+    pcb_turnstile_pushback ( pcb, waitq );
+    pcb -> mpWaitQueue = waitq;
+    pcb -> mTimedOut = 0;
+
+    if ( timeout != PCB_TIMEOUT_NONE )
+    {
+        pcb -> mWakeUpDate = systimer_get_clock ( ) + timeout;
+        pcb_timeout_insert ( pcb );
+    }
+
+    if ( pcb == pcb_running )
+    {
+        scheduler_yield ( );
+    }
+
+    return pcb -> mTimedOut ? -1 : 0;
+}
+
+kernel_pcb_t * pcb_wakeup ( kernel_pcb_turnstile_t * waitq )
+{
+    kernel_pcb_t * pcb = pcb_turnstile_popfront ( waitq );
+
+    if ( ! pcb )
+    {
+        return 0;
+    }
+
+    pcb_timeout_remove ( pcb );
+    pcb -> mpWaitQueue = 0;
+    pcb_turnstile_pushback ( pcb, &turnstile_round_robin );
+
+    return pcb;
+}
+
+void pcb_expire_timeouts ( uint32_t now )
+{
+    while ( pcb_timeouts && ! systimer_date_before ( now, pcb_timeouts -> mWakeUpDate ) )
+    {
+        kernel_pcb_t * pcb = pcb_timeouts;
+        pcb_timeouts = pcb -> mpNextTimeout;
+
+        // Give up waiting
+        pcb_turnstile_remove ( pcb, pcb -> mpWaitQueue );
+        pcb -> mpWaitQueue = 0;
+        pcb -> mTimedOut = 1;
+
+        pcb_turnstile_pushback ( pcb, &turnstile_round_robin );
+    }
+}
+
+int pcb_next_timeout ( uint32_t * date )
+{
+    if ( ! pcb_timeouts )
+    {
+        return -1;
+    }
+
+    * date = pcb_timeouts -> mWakeUpDate;
+    return 0;
+}
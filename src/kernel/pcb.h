@@ -3,6 +3,9 @@
 
 #include <stdint.h>
 #include "arm.h"
+#include "pmu.h"
+
+struct kernel_pcb_turnstile_s;
 
 typedef struct kernel_pcb_s
 {
@@ -10,8 +13,30 @@ typedef struct kernel_pcb_s
 	uint32_t * mpStack;
 	uint32_t mWakeUpDate;
 	struct kernel_pcb_s * mpNext;
+
+	// Wait queue the PCB is blocked on (if any)
+	struct kernel_pcb_turnstile_s * mpWaitQueue;
+
+	// Next PCB in the list of timed waits, sorted by mWakeUpDate
+	struct kernel_pcb_s * mpNextTimeout;
+	int mTimedOut;
+
+	// Identification, and CPU time (cycles) spent running, for inspection
+	uint32_t mPid;
+	void * mpEntry;
+	uint64_t mCpuTime;
+
+	// Performance counts since pmu_start, valid for that generation only
+	struct pmu_counts mPmuCounts;
+	uint32_t mPmuGeneration;
+
+	// Next PCB in the list of all processes
+	struct kernel_pcb_s * mpNextAll;
 } kernel_pcb_t;
 
+// Timeout value meaning "wait forever"
+#define PCB_TIMEOUT_NONE 0xffffffff
+
 /*
  * Creates a new PCB
  * @params:
@@ -23,6 +48,22 @@ typedef struct kernel_pcb_s
  */
 kernel_pcb_t * pcb_create ( void * f, void * args );
 
+struct pcb_info
+{
+	uint32_t pid;
+	void * entry;
+	uint64_t cpu_time;	// CPU cycles, IRQ handlers included
+	struct pmu_counts pmu;	// See pmu_read
+	int running;
+	int blocked;		// On a wait queue
+};
+
+/*
+ * Copies the information of up to n processes to infos.
+ * @return number of processes copied.
+ */
+uint32_t pcb_snapshot ( struct pcb_info * infos, uint32_t n );
+
 /*
  * Puts pcb in sleeping state during duration microseconds.
  * @params:
@@ -32,6 +73,46 @@ kernel_pcb_t * pcb_create ( void * f, void * args );
  */
 void pcb_sleep ( kernel_pcb_t * pcb, uint32_t duration );
 
+/*
+ * Puts pcb in sleeping state until the system timer reaches date.
+ * ASSERT: IRQ have to be disabled prior to call.
+ */
+void pcb_sleep_until ( kernel_pcb_t * pcb, uint32_t date );
+
+/*
+ * Blocks pcb on a wait queue until another process wakes it up with
+ * pcb_wakeup, or until timeout microseconds have elapsed.
+ * @params:
+ * - pcb to block (the running one)
+ * - waitq to block on
+ * - timeout in microseconds, PCB_TIMEOUT_NONE to wait forever.
+ *   A 0 timeout returns immediately without blocking.
+ * @return 0 if woken up by pcb_wakeup, -1 if the timeout expired.
+ * ASSERT: IRQ have to be disabled prior to call.
+ */
+int pcb_block ( kernel_pcb_t * pcb, struct kernel_pcb_turnstile_s * waitq,
+        uint32_t timeout );
+
+/*
+ * Wakes up the first PCB blocked on a wait queue (cancelling its timeout).
+ * @return the woken up PCB, 0 if the wait queue was empty.
+ * ASSERT: IRQ have to be disabled prior to call.
+ */
+kernel_pcb_t * pcb_wakeup ( struct kernel_pcb_turnstile_s * waitq );
+
+/*
+ * Wakes up the PCBs whose timed wait has expired at date now.
+ * ASSERT: IRQ have to be disabled prior to call.
+ */
+void pcb_expire_timeouts ( uint32_t now );
+
+/*
+ * Fetches the date at which the next timed wait will expire.
+ * @return 0 if date has been set, -1 if there is no timed wait.
+ * ASSERT: IRQ have to be disabled prior to call.
+ */
+int pcb_next_timeout ( uint32_t * date );
+
 
 #define r0 0
 #define r1 1
@@ -67,6 +148,13 @@ void pcb_sleep ( kernel_pcb_t * pcb, uint32_t duration );
 #define pcb_enable_irq(pcb) \
 	( pcb ) -> mpSP [ cpsr ] &= ~( ARM_CPSR_IRQ_MASK )
 
+/*
+ * Changes pcb's cpsr (in pcb's stack) to enable FIQs.
+ * ASSERT: pcb is not currently running and pcb->mpSP is on r0.
+ */
+#define pcb_enable_fiq(pcb) \
+	( pcb ) -> mpSP [ cpsr ] &= ~( ARM_CPSR_FIQ_MASK )
+
 /*
  * Changes pcb's cpsr (in pcb's stack) to disable IRQs.
  * ASSERT: pcb is not currently running and pcb->mpSP is on r0.
@@ -26,6 +26,17 @@ void pcb_turnstile_pushback ( kernel_pcb_t * pcb, kernel_pcb_turnstile_t * turns
     turnstile -> mpLast = pcb;
 }
 
+void pcb_turnstile_pushfront ( kernel_pcb_t * pcb, kernel_pcb_turnstile_t * turnstile )
+{
+    pcb -> mpNext = turnstile -> mpFirst;
+    turnstile -> mpFirst = pcb;
+
+    if ( ! turnstile -> mpLast )
+    {
+        turnstile -> mpLast = pcb;
+    }
+}
+
 void pcb_turnstile_sorted_insert ( kernel_pcb_t * pcb, kernel_pcb_turnstile_t * turnstile )
 {
     // Empty turnstile
@@ -25,6 +25,13 @@ int pcb_turnstile_empty ( kernel_pcb_turnstile_t * turnstile );
  */
 void pcb_turnstile_pushback ( kernel_pcb_t * pcb, kernel_pcb_turnstile_t * turnstile );
 
+/*
+ * Adds a PCB to the beginning of a turnstile.
+ * @param PCB to add
+ * @param Turnstile to add to
+ */
+void pcb_turnstile_pushfront ( kernel_pcb_t * pcb, kernel_pcb_turnstile_t * turnstile );
+
 /*
  * Insert a PCB, sorted by mWakeUpDeadline
  * Nearest (lowest) deadline will be first.
@@ -0,0 +1,283 @@
+#include "pipe.h"
+#include "pcb_turnstile.h"
+#include "scheduler.h"
+#include "memory.h"
+#include "config.h"
+#include "arm.h"
+
+#include "../libc/math.h"
+#include "../libc/string.h"
+
+#define PIPE_NB 8
+
+enum
+{
+    PIPE_FREE,
+    PIPE_USED,
+};
+
+struct pipe_s
+{
+    int state;
+
+    uint32_t count;
+    uint32_t first;
+    uint32_t capacity;
+
+    // Processes waiting for data (read) or for free room (write)
+    kernel_pcb_turnstile_t read_waitq;
+    kernel_pcb_turnstile_t write_waitq;
+
+    uint8_t * data;
+};
+
+static struct pipe_s pipes [ PIPE_NB ];
+
+static struct pipe_s * pipe_get ( pipe_t p )
+{
+    // Bound check
+    if ( p < 0 || p >= PIPE_NB )
+    {
+        return 0;
+    }
+
+    return & ( pipes [ p ] );
+}
+
+/*
+ * Copies n bytes from buf to the end of the ring.
+ * ASSERT: there is room for n bytes, IRQ have to be disabled prior to call.
+ */
+static void pipe_put ( struct pipe_s * pp, const uint8_t * buf, uint32_t n )
+{
+    uint32_t last = ( pp -> first + pp -> count ) % pp -> capacity;
+    uint32_t chunk = min ( n, pp -> capacity - last );
+
+    // At most two copies: up to the end of the buffer, then from its start
+    memcpy ( pp -> data + last, buf, chunk );
+    memcpy ( pp -> data, buf + chunk, n - chunk );
+
+    pp -> count += n;
+}
+
+/*
+ * Copies n bytes from the start of the ring to buf.
+ * ASSERT: there are n bytes in the ring, IRQ have to be disabled prior to call.
+ */
+static void pipe_take ( struct pipe_s * pp, uint8_t * buf, uint32_t n )
+{
+    uint32_t chunk = min ( n, pp -> capacity - pp -> first );
+
+    memcpy ( buf, pp -> data + pp -> first, chunk );
+    memcpy ( buf + chunk, pp -> data, n - chunk );
+
+    pp -> first = ( pp -> first + n ) % pp -> capacity;
+    pp -> count -= n;
+}
+
+void pipe_init ( )
+{
+    for ( int i = 0 ; i < PIPE_NB ; ++i )
+    {
+        pipes [ i ].state = PIPE_FREE;
+        pcb_turnstile_init ( & ( pipes [ i ].read_waitq ) );
+        pcb_turnstile_init ( & ( pipes [ i ].write_waitq ) );
+    }
+}
+
+pipe_t pipe_create ( uint32_t capacity )
+{
+    if ( capacity == 0 )
+    {
+        return -1;
+    }
+
+    uint8_t * data = memory_allocate ( capacity );
+    if ( ! data )
+    {
+        return -1;
+    }
+
+    uint32_t irqmask = irq_disable ( );
+
+    for ( int i = 0 ; i < PIPE_NB ; ++i )
+    {
+        struct pipe_s * pp = & ( pipes [ i ] );
+
+        if ( pp -> state != PIPE_FREE )
+        {
+            continue;
+        }
+
+        pp -> state = PIPE_USED;
+        pp -> count = 0;
+        pp -> first = 0;
+        pp -> capacity = capacity;
+        pp -> data = data;
+
+        irq_restore ( irqmask );
+        return i;
+    }
+
+    irq_restore ( irqmask );
+
+    memory_deallocate ( data );
+    return -1;
+}
+
+void pipe_destroy ( pipe_t p )
+{
+    struct pipe_s * pp = pipe_get ( p );
+    if ( ! pp )
+    {
+        return;
+    }
+
+    uint32_t irqmask = irq_disable ( );
+
+    // Nothing to do
+    if ( pp -> state == PIPE_FREE )
+    {
+        irq_restore ( irqmask );
+        return;
+    }
+
+    pp -> state = PIPE_FREE;
+    memory_deallocate ( pp -> data );
+
+    // Release waiting processes: they will notice the pipe is gone
+    while ( pcb_wakeup ( & ( pp -> read_waitq ) ) );
+    while ( pcb_wakeup ( & ( pp -> write_waitq ) ) );
+
+    irq_restore ( irqmask );
+}
+
+int pipe_write ( pipe_t p, const void * buf, size_t n )
+{
+    struct pipe_s * pp = pipe_get ( p );
+    if ( ! pp )
+    {
+        return -1;
+    }
+
+    const uint8_t * src = buf;
+    uint32_t written = 0;
+    uint32_t irqmask = irq_disable ( );
+
+    while ( written < n )
+    {
+        if ( pp -> state != PIPE_USED )
+        {
+            irq_restore ( irqmask );
+            return -1;
+        }
+
+        // Pipe is full: wait for a reader to make room
+        if ( pp -> count == pp -> capacity )
+        {
+            pcb_block ( pcb_running, & ( pp -> write_waitq ), PCB_TIMEOUT_NONE );
+            continue;
+        }
+
+        // Copy as much as there is room for
+        uint32_t batch = min ( pp -> capacity - pp -> count, n - written );
+        batch = min ( batch, KERNEL_PIPE_MAX_BATCH );
+
+        pipe_put ( pp, src + written, batch );
+        written += batch;
+
+        // One wakeup for the whole batch
+        pcb_wakeup ( & ( pp -> read_waitq ) );
+
+        // Let pending IRQ in between two batches
+        irq_restore ( irqmask );
+        irqmask = irq_disable ( );
+    }
+
+    // Room is left: let the next writer (if any) use it
+    if ( pp -> state == PIPE_USED && pp -> count < pp -> capacity )
+    {
+        pcb_wakeup ( & ( pp -> write_waitq ) );
+    }
+
+    irq_restore ( irqmask );
+    return written;
+}
+
+int pipe_read ( pipe_t p, void * buf, size_t n )
+{
+    struct pipe_s * pp = pipe_get ( p );
+    if ( ! pp )
+    {
+        return -1;
+    }
+
+    // Same as pipe_write: nothing to wait for
+    if ( n == 0 )
+    {
+        return 0;
+    }
+
+    uint8_t * dst = buf;
+    uint32_t read = 0;
+    uint32_t irqmask = irq_disable ( );
+
+    while ( read < n )
+    {
+        if ( pp -> state != PIPE_USED )
+        {
+            irq_restore ( irqmask );
+            return -1;
+        }
+
+        if ( pp -> count == 0 )
+        {
+            // Return what we got so far
+            if ( read )
+            {
+                break;
+            }
+
+            // Pipe is empty: wait for a writer
+            pcb_block ( pcb_running, & ( pp -> read_waitq ), PCB_TIMEOUT_NONE );
+            continue;
+        }
+
+        // Copy all available bytes
+        uint32_t batch = min ( pp -> count, n - read );
+        batch = min ( batch, KERNEL_PIPE_MAX_BATCH );
+
+        pipe_take ( pp, dst + read, batch );
+        read += batch;
+
+        // Let pending IRQ in between two batches
+        irq_restore ( irqmask );
+        irqmask = irq_disable ( );
+    }
+
+    if ( pp -> state == PIPE_USED )
+    {
+        // One wakeup for the whole batch
+        pcb_wakeup ( & ( pp -> write_waitq ) );
+
+        // Data is left: let the next reader (if any) have it
+        if ( pp -> count )
+        {
+            pcb_wakeup ( & ( pp -> read_waitq ) );
+        }
+    }
+
+    irq_restore ( irqmask );
+    return read;
+}
+
+uint32_t pipe_count ( pipe_t p )
+{
+    struct pipe_s * pp = pipe_get ( p );
+    if ( ! pp || pp -> state != PIPE_USED )
+    {
+        return 0;
+    }
+
+    return pp -> count;
+}
@@ -0,0 +1,36 @@
+#ifndef _H_PIPE
+#define _H_PIPE
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int pipe_t;
+
+/*
+ * Pipes carry a stream of bytes between processes, through a ring buffer.
+ * Data is copied in bulk, and the peer is woken up once per batch rather
+ * than once per byte or word.
+ */
+
+void pipe_init ( );
+
+pipe_t pipe_create ( uint32_t capacity );
+void pipe_destroy ( pipe_t p );
+
+/*
+ * Reads up to n bytes into buf. Blocks until at least one byte is available,
+ * then copies all available bytes (up to n). Returns 0 right away if n is 0.
+ * @return number of bytes read, -1 if the pipe doesn't exist (anymore).
+ */
+int pipe_read ( pipe_t p, void * buf, size_t n );
+
+/*
+ * Writes n bytes from buf. Blocks until all n bytes have been written.
+ * @return number of bytes written, -1 if the pipe doesn't exist (anymore).
+ */
+int pipe_write ( pipe_t p, const void * buf, size_t n );
+
+// Number of bytes currently in the pipe
+uint32_t pipe_count ( pipe_t p );
+
+#endif
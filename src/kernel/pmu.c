@@ -0,0 +1,125 @@
+#include "pmu.h"
+#include "pcb.h"
+#include "scheduler.h"
+#include "icache.h"
+#include "arm.h"
+
+// Performance Monitor Control Register
+#define PMU_PMNC_ENABLE         ( 1 << 0 )
+#define PMU_PMNC_RESET          ( 1 << 1 )  // Count Registers 0 and 1
+#define PMU_PMNC_RESET_CCNT     ( 1 << 2 )
+#define PMU_PMNC_EVENT0(event)  ( ( event ) << 20 )
+#define PMU_PMNC_EVENT1(event)  ( ( event ) << 12 )
+
+#define PMU_EVENT_MAX 0xff
+
+// Events being counted, and whether processes are charged
+static uint32_t pmu_event0;
+static uint32_t pmu_event1;
+static int pmu_started;
+
+/* Each pmu_start begins a new generation: the counts a process holds from an
+ * older one are stale, and dropped the next time they are used */
+static uint32_t pmu_generation;
+
+// Counters when the running process got the CPU: cycles, event0, event1
+static uint32_t pmu_switch_counters [ 3 ];
+
+void pmu_init ( )
+{
+    arm_pmu_set_control ( PMU_PMNC_ENABLE | PMU_PMNC_RESET | PMU_PMNC_RESET_CCNT );
+    pmu_start ( KERNEL_PMU_EVENT0, KERNEL_PMU_EVENT1 );
+}
+
+int pmu_start ( uint32_t event0, uint32_t event1 )
+{
+    if ( event0 > PMU_EVENT_MAX || event1 > PMU_EVENT_MAX )
+    {
+        return -1;
+    }
+
+    uint32_t irqmask = irq_disable ( );
+
+    // No reset: the cycle counter has to keep going
+    arm_pmu_set_control ( PMU_PMNC_ENABLE |
+            PMU_PMNC_EVENT0 ( event0 ) | PMU_PMNC_EVENT1 ( event1 ) );
+    arm_pmu_read ( pmu_switch_counters );
+
+    pmu_event0 = event0;
+    pmu_event1 = event1;
+    pmu_generation++;
+    pmu_started = 1;
+
+    irq_restore ( irqmask );
+    return 0;
+}
+
+void pmu_stop ( )
+{
+    uint32_t irqmask = irq_disable ( );
+
+    pmu_account ( pcb_running );
+    pmu_started = 0;
+
+    irq_restore ( irqmask );
+}
+
+static ICACHE_HOT void pmu_sync ( kernel_pcb_t * pcb )
+{
+    if ( pcb -> mPmuGeneration != pmu_generation )
+    {
+        pcb -> mPmuGeneration = pmu_generation;
+        pcb -> mPmuCounts.cycles = 0;
+        pcb -> mPmuCounts.event0 = 0;
+        pcb -> mPmuCounts.event1 = 0;
+    }
+}
+
+void pmu_read ( kernel_pcb_t * pcb, struct pmu_counts * counts )
+{
+    uint32_t irqmask = irq_disable ( );
+
+    pmu_sync ( pcb );
+    * counts = pcb -> mPmuCounts;
+
+    // Not charged yet
+    if ( pmu_started && pcb == pcb_running )
+    {
+        uint32_t now [ 3 ];
+        arm_pmu_read ( now );
+
+        counts -> cycles += now [ 0 ] - pmu_switch_counters [ 0 ];
+        counts -> event0 += now [ 1 ] - pmu_switch_counters [ 1 ];
+        counts -> event1 += now [ 2 ] - pmu_switch_counters [ 2 ];
+    }
+
+    irq_restore ( irqmask );
+}
+
+int pmu_get_events ( uint32_t * event0, uint32_t * event1 )
+{
+    * event0 = pmu_event0;
+    * event1 = pmu_event1;
+
+    return pmu_started;
+}
+
+ICACHE_HOT void pmu_account ( kernel_pcb_t * pcb )
+{
+    uint32_t now [ 3 ];
+    arm_pmu_read ( now );
+
+    if ( pcb && pmu_started )
+    {
+        pmu_sync ( pcb );
+
+        // Each counter wraps around: the differences are still right
+        pcb -> mPmuCounts.cycles += now [ 0 ] - pmu_switch_counters [ 0 ];
+        pcb -> mPmuCounts.event0 += now [ 1 ] - pmu_switch_counters [ 1 ];
+        pcb -> mPmuCounts.event1 += now [ 2 ] - pmu_switch_counters [ 2 ];
+    }
+
+    pmu_switch_counters [ 0 ] = now [ 0 ];
+    pmu_switch_counters [ 1 ] = now [ 1 ];
+    pmu_switch_counters [ 2 ] = now [ 2 ];
+}
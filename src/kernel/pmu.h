@@ -0,0 +1,80 @@
+#ifndef _H_KERNEL_PMU
+#define _H_KERNEL_PMU
+
+#include <stdint.h>
+#include "config.h"
+
+/*
+ * ARM1176 Performance Monitor Unit: the cycle counter, and two counters of
+ * one event each, chosen among the ones below. Counts are virtualised per
+ * process: on each context switch, the scheduler charges the process leaving
+ * the CPU with what the counters moved since it got it (pmu_account), along
+ * with its CPU time. Interrupts are charged to the process they interrupt.
+ * The hardware counters never stop, as the kernel measures time with the
+ * cycle counter: stopping the PMU stops the charging.
+ */
+
+// Events (ARM1176 TRM, Performance Monitor Control Register)
+#define PMU_EVENT_ICACHE_MISS       0x00
+#define PMU_EVENT_IFETCH_STALL      0x01    // No instruction to deliver
+#define PMU_EVENT_DATA_STALL        0x02    // Data dependency
+#define PMU_EVENT_IMICROTLB_MISS    0x03
+#define PMU_EVENT_DMICROTLB_MISS    0x04
+#define PMU_EVENT_BRANCH            0x05
+#define PMU_EVENT_BRANCH_MISPREDICT 0x06
+#define PMU_EVENT_INSTRUCTION       0x07
+#define PMU_EVENT_DCACHE_ACCESS     0x0a
+#define PMU_EVENT_DCACHE_MISS       0x0b
+#define PMU_EVENT_DCACHE_WRITEBACK  0x0c
+#define PMU_EVENT_PC_CHANGE         0x0d    // By software
+#define PMU_EVENT_MAINTLB_MISS      0x0f
+#define PMU_EVENT_EXTERNAL_ACCESS   0x10    // Explicit data access
+#define PMU_EVENT_LSU_STALL         0x11    // Load/store unit full
+#define PMU_EVENT_WBUF_DRAIN        0x12
+#define PMU_EVENT_CYCLE             0xff
+
+struct kernel_pcb_s;
+
+struct pmu_counts
+{
+    uint64_t cycles;
+    uint64_t event0;
+    uint64_t event1;
+};
+
+/*
+ * Resets the counters, then starts counting KERNEL_PMU_EVENT0 and
+ * KERNEL_PMU_EVENT1.
+ */
+void pmu_init ( );
+
+/*
+ * Counts event0 and event1 from now on. The counts of every process start
+ * again from 0.
+ * @return 0 on success, -1 on invalid event.
+ */
+int pmu_start ( uint32_t event0, uint32_t event1 );
+
+// Stops charging processes: their counts stay as they are
+void pmu_stop ( );
+
+/*
+ * Copies the counts of pcb since the last pmu_start to counts (up to now for
+ * the running process).
+ */
+void pmu_read ( struct kernel_pcb_s * pcb, struct pmu_counts * counts );
+
+/*
+ * Copies the events being counted to event0 and event1.
+ * @return 1 while started, 0 once stopped.
+ */
+int pmu_get_events ( uint32_t * event0, uint32_t * event1 );
+
+/*
+ * Charges pcb (0 for none) with the counts since the last call, for the
+ * scheduler on context switches.
+ * ASSERT: IRQ have to be disabled prior to call.
+ */
+void pmu_account ( struct kernel_pcb_s * pcb );
+
+#endif
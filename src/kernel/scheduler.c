@@ -1,6 +1,10 @@
 #define _C_SCHEDULER
 #include "scheduler.h"
 #include "bcm2835/systimer.h"
+#include "../libc/math.h"
+#include "arm.h"
+#include "icache.h"
+#include "pmu.h"
 
 kernel_pcb_t * pcb_running;
 static kernel_pcb_t pcb_idle;
@@ -8,7 +12,11 @@ static kernel_pcb_t pcb_idle;
 kernel_pcb_turnstile_t turnstile_round_robin;
 kernel_pcb_turnstile_t turnstile_sleeping;
 
+// Cycle counter value when the running process got the CPU
+static uint32_t scheduler_switch_date;
+
 static void scheduler_elect ( );
+static void scheduler_program_timer ( );
 static void __attribute__ ( ( noreturn ) ) idle_process ( );
 
 extern void scheduler_ctxsw ( );
@@ -17,10 +25,15 @@ extern void scheduler_ctxsw ( );
 void scheduler_init ( )
 {
     pcb_idle.mpStack = 0;
+    pcb_idle.mPid = 0;
+    pcb_idle.mpEntry = idle_process;
+    pcb_idle.mCpuTime = 0;
+    pcb_idle.mpWaitQueue = 0;
     pcb_idle.mpSP = ( void * ) 0x3000;
     pcb_set_register ( &pcb_idle, pc, ( uintptr_t ) idle_process );
     pcb_inherit_cpsr ( &pcb_idle );
     pcb_enable_irq ( &pcb_idle );
+    pcb_enable_fiq ( &pcb_idle );
 
     pcb_turnstile_init ( &turnstile_round_robin );
     pcb_turnstile_init ( &turnstile_sleeping );
@@ -28,44 +41,111 @@ void scheduler_init ( )
     pcb_running = 0;
 }
 
-void * scheduler_handler ( void * oldSP )
+// Charges the running process for the CPU time and PMU counts it just used
+static ICACHE_HOT void scheduler_account ( kernel_pcb_t * pcb )
+{
+    uint32_t now = arm_get_cycle_count ( );
+
+    if ( pcb )
+    {
+        pcb -> mCpuTime += now - scheduler_switch_date;
+    }
+
+    scheduler_switch_date = now;
+
+    pmu_account ( pcb );
+}
+
+kernel_pcb_t * scheduler_get_idle ( )
+{
+    return &pcb_idle;
+}
+
+ICACHE_HOT void * scheduler_handler ( void * oldSP )
 {
     pcb_running -> mpSP = oldSP;
+    scheduler_account ( pcb_running );
     scheduler_elect ( );
-    systimer_update ( KERNEL_SCHEDULER_TIMER_PERIOD );
+    scheduler_program_timer ( );
+
+#ifdef KERNEL_TRACE_IRQOFF
+    irqoff_trace_switch ( pcb_running -> mpSP [ cpsr ] );
+#endif
 
     return pcb_running -> mpSP;
 }
 
 void scheduler_reschedule ( void * oldSP )
 {
+    // No oldSP: there is no running process, or it just exited
     if ( oldSP )
     {
         pcb_running -> mpSP = oldSP;
     }
 
+    scheduler_account ( oldSP ? pcb_running : 0 );
     scheduler_elect ( );
-    systimer_update ( KERNEL_SCHEDULER_TIMER_PERIOD );
+    scheduler_program_timer ( );
+
+#ifdef KERNEL_TRACE_IRQOFF
+    irqoff_trace_switch ( pcb_running -> mpSP [ cpsr ] );
+#endif
+
     scheduler_ctxsw ( pcb_running -> mpSP );
 }
 
+// Microseconds left until date (0 if date is already in the past)
+static uint32_t scheduler_time_left ( uint32_t date, uint32_t now )
+{
+    return systimer_date_before ( now, date ) ? date - now : 0;
+}
+
+/*
+ * The next tick happens at the end of the time slice, or earlier if a sleeping
+ * process or a timed wait has to be woken up before.
+ */
+void scheduler_program_timer ( )
+{
+    uint32_t now = systimer_get_clock ( );
+    uint32_t delay = KERNEL_SCHEDULER_TIMER_PERIOD;
+    uint32_t date;
+
+    if ( turnstile_sleeping.mpFirst )
+    {
+        date = turnstile_sleeping.mpFirst -> mWakeUpDate;
+        delay = min ( delay, scheduler_time_left ( date, now ) );
+    }
+
+    if ( pcb_next_timeout ( &date ) == 0 )
+    {
+        delay = min ( delay, scheduler_time_left ( date, now ) );
+    }
+
+    // The compare register must be set far enough to not be missed
+    delay = max ( delay, KERNEL_SCHEDULER_TIMER_MIN_DELAY );
+
+    systimer_update ( delay );
+}
+
 void scheduler_elect ( )
 {
+    uint32_t now = systimer_get_clock ( );
+
     // We wake up sleeping processes
-    if ( turnstile_sleeping.mpFirst )
+    /* A simple timestamp comparison here would cause problems since the
+     * clock overflows every 71min35sec. Only disadvantage is we can't
+     * sleep more than 35min47sec. */
+    while ( turnstile_sleeping.mpFirst && ! systimer_date_before ( now,
+                turnstile_sleeping.mpFirst -> mWakeUpDate ) )
     {
-        /* A simple timestamp comparison here would cause problems since the
-         * clock overflows every 71min35sec. Only disadvantage is we can't
-         * sleep more than 35min47sec. */
-        if ( systimer_get_clock ( ) - turnstile_sleeping.mpFirst -> mWakeUpDate
-                < 0x80000000UL )
-        {
-            kernel_pcb_t * current;
-            current = pcb_turnstile_popfront ( &turnstile_sleeping );
-            pcb_turnstile_pushback ( current, &turnstile_round_robin );
-        }
+        kernel_pcb_t * current;
+        current = pcb_turnstile_popfront ( &turnstile_sleeping );
+        pcb_turnstile_pushback ( current, &turnstile_round_robin );
     }
 
+    // We wake up processes whose timed wait expired
+    pcb_expire_timeouts ( now );
+
     if ( turnstile_round_robin.mpFirst )
     {
         pcb_running = turnstile_round_robin.mpFirst;
@@ -24,4 +24,7 @@ void scheduler_reschedule ( void * oldSP );
 
 extern void scheduler_yield ( );
 
+// The idle process, which runs when no other process is ready
+kernel_pcb_t * scheduler_get_idle ( );
+
 #endif
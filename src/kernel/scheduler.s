@@ -1,10 +1,19 @@
 @ vim: ft=arm
+/* Run by every interrupt which elects a process: locked into the I-cache,
+ * see icache.h */
+.section .text.hot, "ax", %progbits
+
 .globl scheduler_ctxsw
 scheduler_ctxsw:
     mov sp, r0
     ldmfd sp!, { r0 - r12, lr }
+
+    // Never resume a process with the exclusive monitor of another, see irq.s
+    clrex
     rfefd sp!
 
+.text
+
 .globl scheduler_yield
 scheduler_yield:
     // Store cpsr to stack, but preserving original r0
@@ -1,8 +1,7 @@
 #include "semaphore.h"
 #include "pcb_turnstile.h"
 #include "scheduler.h"
-
-#define SEM_MAX 32
+#include "evset.h"
 
 enum
 {
@@ -14,7 +13,14 @@ struct semaphore
 {
     kernel_pcb_turnstile_t waitqueue;
     int state;
+
+    /* Number of wait that would not block. Never negative: signal hands its
+     * token over to a waiter directly, so a waiter that times out (removed
+     * from waitqueue by pcb_expire_timeouts) has nothing to give back. */
     int count;
+
+    // Event set to notify when the semaphore can be taken (-1 if none)
+    evset_t evset;
 };
 
 static struct semaphore sems [ SEM_MAX ];
@@ -45,6 +51,7 @@ sem_t sem_create ( int count )
         {
             sems [ i ].state = SEM_USED;
             sems [ i ].count = count;
+            sems [ i ].evset = -1;
             irq_restore ( irqmask );
             return i;
         }
@@ -67,6 +74,7 @@ void sem_destroy ( sem_t sem )
     // Semaphore is already free. No need to destroy...
     if ( sems [ sem ].state == SEM_FREE )
     {
+        irq_restore ( irqmask );
         return;
     }
 
@@ -74,18 +82,20 @@ void sem_destroy ( sem_t sem )
     sems [ sem ].state = SEM_FREE;
 
     // Release waiting processes from the semaphore (if any)
-    kernel_pcb_turnstile_t * waitq = & ( sems [ sem ].waitqueue );
-    while ( ! pcb_turnstile_empty ( waitq ) )
-    {
-        kernel_pcb_t * pcb = pcb_turnstile_popfront ( waitq );
-        pcb_turnstile_pushback ( pcb, &turnstile_round_robin );
-    }
+    while ( pcb_wakeup ( & ( sems [ sem ].waitqueue ) ) );
 
     irq_restore ( irqmask );
 }
 
 int wait ( sem_t sem )
 {
+    return wait_timeout ( sem, PCB_TIMEOUT_NONE );
+}
+
+int wait_timeout ( sem_t sem, uint32_t timeout )
+{
+    int status = 0;
+
     // Bound check
     if ( sem < 0 || sem >= SEM_MAX )
     {
@@ -100,19 +110,20 @@ int wait ( sem_t sem )
         return -1;
     }
 
-    sems [ sem ].count--;
-
-    if ( sems [ sem ].count < 0 )
+    if ( sems [ sem ].count > 0 )
     {
-        pcb_turnstile_remove ( pcb_running, &turnstile_round_robin );
-        pcb_turnstile_pushback ( pcb_running, & ( sems [ sem ].waitqueue ) );
+        sems [ sem ].count--;
+    }
 
-        scheduler_yield ( );
+    // Woken up by signal, the token is ours
+    else
+    {
+        status = pcb_block ( pcb_running, & ( sems [ sem ].waitqueue ), timeout );
     }
 
     irq_restore ( irqmask );
 
-    return 0;
+    return status;
 }
 
 int signal ( sem_t sem )
@@ -131,16 +142,66 @@ int signal ( sem_t sem )
         return -1;
     }
 
-    sems [ sem ].count++;
+    // Hand the token over to the first waiter, if any
+    if ( ! pcb_wakeup ( & ( sems [ sem ].waitqueue ) ) )
+    {
+        sems [ sem ].count++;
+
+        if ( sems [ sem ].evset >= 0 )
+        {
+            evset_notify ( sems [ sem ].evset );
+        }
+    }
+    irq_restore ( irqmask );
+
+    return 0;
+}
+
+int sem_count ( sem_t sem )
+{
+    // Bound check
+    if ( sem < 0 || sem >= SEM_MAX || sems [ sem ].state != SEM_USED )
+    {
+        return 0;
+    }
+
+    uint32_t irqmask = irq_disable ( );
+    int count = sems [ sem ].count;
 
-    // Put the pcb from waiting to ready state
-    if ( sems [ sem ].count <= 0 )
+    for ( kernel_pcb_t * pcb = sems [ sem ].waitqueue.mpFirst ; pcb ; pcb = pcb -> mpNext )
     {
-        kernel_pcb_turnstile_t * waitq = & ( sems [ sem ].waitqueue );
-        kernel_pcb_t * pcb = pcb_turnstile_popfront ( waitq );
-        pcb_turnstile_pushback ( pcb, &turnstile_round_robin );
+        count--;
     }
+
     irq_restore ( irqmask );
 
+    return count;
+}
+
+int sem_set_evset ( sem_t sem, int set )
+{
+    // Bound check
+    if ( sem < 0 || sem >= SEM_MAX )
+    {
+        return -1;
+    }
+
+    uint32_t irqmask = irq_disable ( );
+
+    if ( sems [ sem ].state != SEM_USED
+        || ( set >= 0 && sems [ sem ].evset >= 0 ) )
+    {
+        irq_restore ( irqmask );
+        return -1;
+    }
+
+    sems [ sem ].evset = set;
+
+    irq_restore ( irqmask );
     return 0;
 }
+
+int sem_used ( sem_t sem )
+{
+    return sem >= 0 && sem < SEM_MAX && sems [ sem ].state == SEM_USED;
+}
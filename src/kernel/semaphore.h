@@ -5,6 +5,9 @@
 
 typedef int sem_t;
 
+// Semaphores are numbered from 0 to SEM_MAX - 1
+#define SEM_MAX 32
+
 void sem_init ( );
 
 sem_t sem_create ( int count );
@@ -13,4 +16,27 @@ void sem_destroy ( sem_t sem );
 int wait ( );
 int signal ( );
 
+/*
+ * Same as wait, but gives up after timeout microseconds.
+ * @return 0 on success, -1 on error or if the timeout expired.
+ */
+int wait_timeout ( sem_t sem, uint32_t timeout );
+
+/*
+ * Current value of the semaphore: the number of wait that would not block
+ * if positive, minus the number of waiting processes otherwise.
+ * @return the count, 0 if the semaphore doesn't exist.
+ */
+int sem_count ( sem_t sem );
+
+// @return whether the semaphore exists
+int sem_used ( sem_t sem );
+
+/*
+ * Attaches the semaphore to an event set (or detaches it with set -1).
+ * Used by the event sets only, see evset.h.
+ * @return 0 on success, -1 on error or if already attached.
+ */
+int sem_set_evset ( sem_t sem, int set );
+
 #endif
@@ -0,0 +1,132 @@
+#include "spsc_ring.h"
+#include "pcb_turnstile.h"
+#include "scheduler.h"
+#include "arm.h"
+
+// Prevent the compiler from reordering memory accesses across this point
+#define compiler_barrier() __asm volatile ( "" ::: "memory" )
+
+int spsc_ring_init ( struct spsc_ring * ring, uint32_t * buf, uint32_t capacity )
+{
+    if ( capacity == 0 || ( capacity & ( capacity - 1 ) ) )
+    {
+        return -1;
+    }
+
+    ring -> head = 0;
+    ring -> tail = 0;
+    ring -> mask = capacity - 1;
+    ring -> data = buf;
+    ring -> wait_slot = 0;
+    ring -> waiter = & ( ring -> wait_slot );
+
+    return 0;
+}
+
+uint32_t spsc_ring_count ( struct spsc_ring * ring )
+{
+    return ring -> head - ring -> tail;
+}
+
+int spsc_ring_push ( struct spsc_ring * ring, uint32_t val )
+{
+    uint32_t head = ring -> head;
+
+    if ( head - ring -> tail > ring -> mask )
+    {
+        return -1;
+    }
+
+    // Store the element before publishing it
+    ring -> data [ head & ring -> mask ] = val;
+    compiler_barrier ( );
+    ring -> head = head + 1;
+
+    // Slow path: the consumer is sleeping, wake it up
+    if ( * ( ring -> waiter ) )
+    {
+        uint32_t irqmask = irq_disable ( );
+        kernel_pcb_t * pcb = * ( ring -> waiter );
+        if ( pcb )
+        {
+            * ( ring -> waiter ) = 0;
+            pcb_turnstile_pushback ( pcb, &turnstile_round_robin );
+        }
+        irq_restore ( irqmask );
+    }
+
+    return 0;
+}
+
+int spsc_ring_pop ( struct spsc_ring * ring, uint32_t * val )
+{
+    uint32_t tail = ring -> tail;
+
+    if ( ring -> head == tail )
+    {
+        return -1;
+    }
+
+    // Fetch the element before releasing its slot
+    * val = ring -> data [ tail & ring -> mask ];
+    compiler_barrier ( );
+    ring -> tail = tail + 1;
+
+    return 0;
+}
+
+uint32_t spsc_ring_pop_wait ( struct spsc_ring * ring )
+{
+    uint32_t val;
+
+    spsc_ring_pop_wait_any ( &ring, 1, &val );
+
+    return val;
+}
+
+void spsc_ring_share_waiter ( struct spsc_ring * ring, struct spsc_ring * leader )
+{
+    ring -> waiter = leader -> waiter;
+}
+
+// ASSERT: IRQ have to be disabled prior to call.
+static int spsc_ring_all_empty ( struct spsc_ring ** rings, uint32_t n )
+{
+    for ( uint32_t i = 0 ; i < n ; ++i )
+    {
+        if ( rings [ i ] -> head != rings [ i ] -> tail )
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+uint32_t spsc_ring_pop_wait_any ( struct spsc_ring ** rings, uint32_t n,
+        uint32_t * val )
+{
+    for ( ; ; )
+    {
+        for ( uint32_t i = 0 ; i < n ; ++i )
+        {
+            if ( spsc_ring_pop ( rings [ i ], val ) == 0 )
+            {
+                return i;
+            }
+        }
+
+        /* Check for emptiness again with IRQ masked: no producer may push
+         * between our check and our sleep, or its wakeup would be lost. The
+         * rings share one waiter slot, so whichever producer comes first
+         * wakes us up, and only once. */
+        uint32_t irqmask = irq_disable ( );
+        if ( spsc_ring_all_empty ( rings, n ) )
+        {
+            * ( rings [ 0 ] -> waiter ) = pcb_running;
+            pcb_turnstile_remove ( pcb_running, &turnstile_round_robin );
+            scheduler_yield ( );
+        }
+        irq_restore ( irqmask );
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef _H_SPSC_RING
+#define _H_SPSC_RING
+
+#include <stdint.h>
+#include "pcb.h"
+
+/*
+ * Single-Producer Single-Consumer ring buffer of 32-bit words.
+ * Typical use: an interrupt handler produces events, one thread consumes them.
+ *
+ * Push and pop are lock-free: the producer only ever writes head, the consumer
+ * only ever writes tail. IRQ are masked only when a process has to be woken
+ * up or put to sleep.
+ *
+ * head and tail are free running counters: the number of elements in the ring
+ * is always head - tail, even after they wrap around.
+ */
+struct spsc_ring
+{
+    volatile uint32_t head;     // Written by the producer only
+    volatile uint32_t tail;     // Written by the consumer only
+    uint32_t mask;              // Capacity - 1
+    uint32_t * data;
+
+    // Consumer blocked in spsc_ring_pop_wait (if any)
+    kernel_pcb_t * volatile wait_slot;
+
+    // Slot to wake up on push: wait_slot, or that of another ring
+    kernel_pcb_t * volatile * waiter;
+};
+
+/*
+ * Initializes a ring buffer.
+ * @params:
+ * - buf: storage for capacity elements
+ * - capacity: has to be a power of 2
+ * @return 0 on success, -1 if capacity is not a power of 2.
+ */
+int spsc_ring_init ( struct spsc_ring * ring, uint32_t * buf, uint32_t capacity );
+
+// Number of elements currently in the ring
+uint32_t spsc_ring_count ( struct spsc_ring * ring );
+
+/*
+ * Producer side: appends an element and wakes the consumer up if it is
+ * blocked waiting for one.
+ * @return 0 on success, -1 if the ring is full (element is dropped).
+ */
+int spsc_ring_push ( struct spsc_ring * ring, uint32_t val );
+
+/*
+ * Consumer side: removes the oldest element without blocking.
+ * @return 0 on success, -1 if the ring is empty.
+ */
+int spsc_ring_pop ( struct spsc_ring * ring, uint32_t * val );
+
+/*
+ * Consumer side: removes the oldest element, blocking while the ring is empty.
+ * ASSERT: Never to be called from IRQ context.
+ */
+uint32_t spsc_ring_pop_wait ( struct spsc_ring * ring );
+
+/*
+ * Makes pushes to ring wake up the consumer sleeping on leader, so that one
+ * consumer can block on several rings, each with its own producer.
+ * ASSERT: Both rings are empty and have no consumer blocked.
+ */
+void spsc_ring_share_waiter ( struct spsc_ring * ring, struct spsc_ring * leader );
+
+/*
+ * Consumer side: removes the oldest element of the first non-empty ring,
+ * blocking while they are all empty. The rings must share the waiter of
+ * rings [ 0 ], see spsc_ring_share_waiter.
+ * @return the index of the ring the element was taken from.
+ * ASSERT: Never to be called from IRQ context.
+ */
+uint32_t spsc_ring_pop_wait_any ( struct spsc_ring ** rings, uint32_t n,
+        uint32_t * val );
+
+#endif
@@ -0,0 +1,50 @@
+#include "telemetry.h"
+#include "telemetry_frame.h"
+#include "pcb.h"
+#include "scheduler.h"
+#include "arm.h"
+#include "bcm2835/uart.h"
+
+// Sequence number of the next frame of each channel
+static uint8_t telemetry_seq [ TELEMETRY_CHANNELS ];
+
+int telemetry_send ( uint8_t channel, const void * data, uint32_t n )
+{
+    uint8_t frame [ TELEMETRY_FRAME_MAX ];
+
+    if ( n > TELEMETRY_MAX_PAYLOAD )
+    {
+        return -1;
+    }
+
+    /* Frames are encoded with IRQ enabled. Their sequence number is only
+     * taken once queued: start again if another sender got it meanwhile. */
+    uint8_t seq = telemetry_seq [ channel ];
+    uint32_t size = telemetry_frame_encode ( channel, seq, data, n, frame );
+
+    uint32_t irqmask = irq_disable ( );
+
+    for ( ; ; )
+    {
+        if ( telemetry_seq [ channel ] != seq )
+        {
+            seq = telemetry_seq [ channel ];
+            irq_restore ( irqmask );
+            size = telemetry_frame_encode ( channel, seq, data, n, frame );
+            irqmask = irq_disable ( );
+            continue;
+        }
+
+        if ( uart_try_write ( frame, size ) == 0 )
+        {
+            break;
+        }
+
+        pcb_sleep ( pcb_running, TELEMETRY_RETRY_DELAY );
+    }
+
+    telemetry_seq [ channel ] = seq + 1;
+
+    irq_restore ( irqmask );
+    return 0;
+}
@@ -0,0 +1,28 @@
+#ifndef _H_TELEMETRY
+#define _H_TELEMETRY
+
+#include <stdint.h>
+
+/*
+ * Binary telemetry over the console UART. Each message is sent as a frame
+ * (see telemetry_frame.h) on a channel, numbered by the sender: the host
+ * receiver (host/telemrx/) decodes frames, checks them and reports lost
+ * ones, and passes the console text through.
+ *
+ * Frames never mix with other output, but raw bytes written with
+ * uart_write_dma may look like delimiters to the receiver.
+ */
+
+#define TELEMETRY_CHANNELS 256
+
+// How long senders sleep when the UART queue has no room (microseconds)
+#define TELEMETRY_RETRY_DELAY 1000
+
+/*
+ * Sends n bytes (at most TELEMETRY_MAX_PAYLOAD) on channel. Waits for room
+ * in the UART queue: not for interrupt handlers.
+ * @return 0 on success, -1 if the payload is too large.
+ */
+int telemetry_send ( uint8_t channel, const void * data, uint32_t n );
+
+#endif
@@ -0,0 +1,144 @@
+#include "telemetry_frame.h"
+
+// COBS encoder state, see telemetry_frame_encode
+struct cobs_state
+{
+    uint8_t * dst;
+    uint32_t code_at;   // Where the code of the current block goes
+    uint32_t out;       // Next free byte
+    uint8_t code;       // 1 + number of bytes in the current block
+};
+
+static void cobs_begin ( struct cobs_state * cs, uint8_t * dst )
+{
+    cs -> dst = dst;
+    cs -> code_at = 0;
+    cs -> out = 1;
+    cs -> code = 1;
+}
+
+// Ends the current block, with an implicit zero byte unless it is full
+static void cobs_close_block ( struct cobs_state * cs )
+{
+    cs -> dst [ cs -> code_at ] = cs -> code;
+    cs -> code_at = cs -> out++;
+    cs -> code = 1;
+}
+
+static void cobs_put ( struct cobs_state * cs, uint8_t b )
+{
+    if ( b == 0 )
+    {
+        cobs_close_block ( cs );
+        return;
+    }
+
+    cs -> dst [ cs -> out++ ] = b;
+
+    // Blocks hold at most 254 bytes
+    if ( ++cs -> code == 0xff )
+    {
+        cobs_close_block ( cs );
+    }
+}
+
+// @return the size of the encoded data
+static uint32_t cobs_end ( struct cobs_state * cs )
+{
+    cs -> dst [ cs -> code_at ] = cs -> code;
+    return cs -> out;
+}
+
+uint16_t telemetry_crc16 ( uint16_t crc, const uint8_t * data, uint32_t n )
+{
+    for ( uint32_t i = 0 ; i < n ; ++i )
+    {
+        crc ^= data [ i ] << 8;
+
+        for ( int bit = 0 ; bit < 8 ; ++bit )
+        {
+            crc = ( crc & 0x8000 ) ? ( crc << 1 ) ^ 0x1021 : crc << 1;
+        }
+    }
+
+    return crc;
+}
+
+uint32_t telemetry_frame_encode ( uint8_t channel, uint8_t seq,
+        const void * payload, uint32_t n, uint8_t * frame )
+{
+    const uint8_t * data = payload;
+    uint8_t header [ 2 ] = { channel, seq };
+    struct cobs_state cs;
+
+    if ( n > TELEMETRY_MAX_PAYLOAD )
+    {
+        n = TELEMETRY_MAX_PAYLOAD;
+    }
+
+    uint16_t crc = telemetry_crc16 ( 0xffff, header, 2 );
+    crc = telemetry_crc16 ( crc, data, n );
+
+    frame [ 0 ] = 0;
+    cobs_begin ( &cs, frame + 1 );
+
+    cobs_put ( &cs, channel );
+    cobs_put ( &cs, seq );
+    for ( uint32_t i = 0 ; i < n ; ++i )
+    {
+        cobs_put ( &cs, data [ i ] );
+    }
+    cobs_put ( &cs, crc & 0xff );
+    cobs_put ( &cs, crc >> 8 );
+
+    uint32_t size = 1 + cobs_end ( &cs );
+    frame [ size ] = 0;
+
+    return size + 1;
+}
+
+int telemetry_frame_decode ( const uint8_t * frame, uint32_t n, uint8_t * raw )
+{
+    uint32_t len = 0;
+    uint32_t i = 0;
+
+    while ( i < n )
+    {
+        uint32_t code = frame [ i++ ];
+
+        if ( code == 0 || i + code - 1 > n ||
+                len + code - 1 > TELEMETRY_RAW_MAX )
+        {
+            return -1;
+        }
+
+        for ( uint32_t j = 1 ; j < code ; ++j )
+        {
+            raw [ len++ ] = frame [ i++ ];
+        }
+
+        // Implicit zero, except after a full block or at the end
+        if ( code < 0xff && i < n )
+        {
+            if ( len == TELEMETRY_RAW_MAX )
+            {
+                return -1;
+            }
+
+            raw [ len++ ] = 0;
+        }
+    }
+
+    if ( len < 4 )
+    {
+        return -1;
+    }
+
+    uint16_t crc = raw [ len - 2 ] | ( raw [ len - 1 ] << 8 );
+    if ( telemetry_crc16 ( 0xffff, raw, len - 2 ) != crc )
+    {
+        return -1;
+    }
+
+    return len - 4;
+}
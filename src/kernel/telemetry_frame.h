@@ -0,0 +1,45 @@
+#ifndef _H_KERNEL_TELEMETRY_FRAME
+#define _H_KERNEL_TELEMETRY_FRAME
+
+#include <stdint.h>
+
+/*
+ * Telemetry frames, shared by the kernel and the host receiver
+ * (host/telemrx/). A frame carries:
+ *     channel (1 byte), sequence number (1 byte), payload, CRC (2 bytes)
+ * The CRC is the CRC-16/CCITT (polynomial 0x1021, initial value 0xffff) of
+ * the channel, the sequence number and the payload, least significant byte
+ * first.
+ * The whole is COBS encoded, so that it holds no zero byte, and put between
+ * two zero bytes. Console text never holds zero bytes either: the receiver
+ * tells frames from text by their CRC.
+ */
+
+#define TELEMETRY_MAX_PAYLOAD 256
+
+// Channel, sequence number and CRC around the payload
+#define TELEMETRY_RAW_MAX ( TELEMETRY_MAX_PAYLOAD + 4 )
+
+// COBS adds one byte every 254 bytes, plus the two delimiters
+#define TELEMETRY_FRAME_MAX \
+    ( TELEMETRY_RAW_MAX + TELEMETRY_RAW_MAX / 254 + 1 + 2 )
+
+uint16_t telemetry_crc16 ( uint16_t crc, const uint8_t * data, uint32_t n );
+
+/*
+ * Builds the frame of n bytes of payload (at most TELEMETRY_MAX_PAYLOAD) in
+ * frame, delimiters included.
+ * @return the size of the frame, at most TELEMETRY_FRAME_MAX.
+ */
+uint32_t telemetry_frame_encode ( uint8_t channel, uint8_t seq,
+        const void * payload, uint32_t n, uint8_t * frame );
+
+/*
+ * Decodes the n bytes found between two delimiters into raw (at least
+ * TELEMETRY_RAW_MAX bytes): the channel, the sequence number, then the
+ * payload.
+ * @return the size of the payload, -1 if this is not a valid frame.
+ */
+int telemetry_frame_decode ( const uint8_t * frame, uint32_t n, uint8_t * raw );
+
+#endif
@@ -208,13 +208,6 @@ static int usb_read_conf_desc ( struct usb_device * dev, uint8_t idx )
     struct usb_conf_desc conf;
     int status;
 
-    struct usb_desc_hdr * hdr;
-    struct usb_intf_desc * intf;
-    struct usb_endp_desc * endp;
-
-    int intf_idx;
-    int endp_idx;
-
     /* First, fetch only the configuration desc without intf & endp.
      * That way we'll know the wTotalLength to allocate */
     status = usb_get_conf_desc ( dev, idx, &conf, sizeof ( conf ) );
@@ -238,83 +231,7 @@ static int usb_read_conf_desc ( struct usb_device * dev, uint8_t idx )
         printuln ( "Error when getting whole configuration desc" );
     }
 
-    // Set the interface and endpoint pointers
-    intf_idx = -1;
-    endp_idx = -1;
-    for ( uint32_t i = 0 ;
-            i < dev -> conf_desc -> wTotalLength ; i += hdr -> bLength )
-    {
-        hdr = ( struct usb_desc_hdr * ) ( ( uint8_t * ) ( dev -> conf_desc ) + i );
-
-        if ( hdr -> bLength < sizeof ( struct usb_desc_hdr ) )
-        {
-            printuln ( "Invalid bLength in configuration descriptor header" );
-            return -1;
-        }
-
-        switch ( hdr -> bDescriptorType )
-        {
-            case USB_DESC_INTF:
-                intf = ( struct usb_intf_desc * ) hdr;
-
-                // TODO: Handle alternate settings
-                if ( intf -> bAlternateSetting != 0 )
-                {
-                    printuln ( "Skipping alternate settings intf..." );
-                    break;
-                }
-
-                if ( ++intf_idx >= USB_MAX_INTF )
-                {
-                    printuln ( "Too many interfaces" );
-                    return -1;
-                }
-                if ( intf_idx >= dev -> conf_desc -> bNumInterfaces )
-                {
-                    printuln ( "bNumInterfaces mismatch" );
-                    return -1;
-                }
-
-                dev -> intf_desc [ intf_idx ] = intf;
-                endp_idx = -1;
-                break;
-
-            case USB_DESC_ENDP:
-                if ( intf_idx < 0 )
-                {
-                    printuln ( "Endpoint belonging to no Interface" );
-                    return -1;
-                }
-
-                // TODO: Handle alternate settings
-                if ( intf -> bAlternateSetting != 0 )
-                {
-                    printuln ( "Skipping endp of alternate settings intf..." );
-                    break;
-                }
-
-                endp = ( struct usb_endp_desc * ) hdr;
-
-                if ( ++endp_idx >= USB_MAX_ENDP )
-                {
-                    printuln ( "Too many endpoints" );
-                    return -1;
-                }
-                if ( endp_idx >= intf -> bNumEndpoints )
-                {
-                    printuln ( "bNumEnpoints mismatch" );
-                    return -1;
-                }
-
-                dev -> endp_desc [ intf_idx ] [ endp_idx ] = endp;
-                break;
-
-            default:
-                break;
-        }
-    }
-
-    return USB_STATUS_SUCCESS;
+    return usb_parse_conf_desc ( dev );
 }
 
 int usb_set_configuration ( struct usb_device * dev, uint8_t conf )
@@ -513,25 +430,28 @@ void usb_init ( )
     }
 
     // Create the root hub
-    if ( ! ( usb_root = usb_alloc_device ( 0 ) ) )
+    struct usb_device * root = usb_alloc_device ( 0 );
+    if ( ! root )
     {
         printuln ( "USB Core failed to allocate the root hub" );
         goto err_hcd_stop;
     }
 
     // Enumerate the root hub
-    if ( usb_enumerate_device ( usb_root ) != 0 )
+    if ( usb_enumerate_device ( root ) != 0 )
     {
         printuln ( "USB Core failed to enumerate the root hub" );
         goto err_free_root_hub;
     }
 
+    // Only walk the tree once the root hub is bound
+    usb_root = root;
+
     printuln ( "USB Core Initialization complete" );
     return;
 
 err_free_root_hub:
-    usb_free_device ( usb_root );
-    usb_root = 0;
+    usb_free_device ( root );
 err_hcd_stop:
     hcd_stop ( );
 err_usb_unregister_hub_driver:
@@ -9,6 +9,9 @@
 
 void usb_init ( );
 
+// Root hub device, null until the host controller is set up
+extern struct usb_device * usb_root;
+
 struct usb_request;
 typedef void ( * usb_request_callback_t ) ( struct usb_request * req );
 
@@ -73,6 +76,10 @@ struct usb_request
     // For the Host Controller
     enum usb_ctrl_stage ctrl_stage;
     uint8_t next_data_toggle;
+
+    // NAKed requests waiting to be relaunched
+    struct usb_request * next_deferred;
+    uint32_t defer_date;
 };
 
 struct usb_driver
@@ -99,4 +106,11 @@ int usb_ctrl_req ( struct usb_device * dev,
         uint8_t bRequest, uint16_t wValue, uint16_t wIndex,
         void * data, uint16_t wLength );
 
+/*
+ * Sets the interface and endpoint descriptor pointers of dev, from its whole
+ * configuration descriptor (dev -> conf_desc). No hardware access.
+ * @return USB_STATUS_SUCCESS, -1 if the descriptor is invalid.
+ */
+int usb_parse_conf_desc ( struct usb_device * dev );
+
 #endif
@@ -0,0 +1,98 @@
+#include "usb_core.h"
+#include "bcm2835/uart.h"
+
+int usb_parse_conf_desc ( struct usb_device * dev )
+{
+    struct usb_desc_hdr * hdr;
+    struct usb_intf_desc * intf = 0;
+    struct usb_endp_desc * endp;
+
+    int intf_idx;
+    int endp_idx;
+
+    // Set the interface and endpoint pointers
+    intf_idx = -1;
+    endp_idx = -1;
+    uint32_t total = dev -> conf_desc -> wTotalLength;
+    for ( uint32_t i = 0 ; i < total ; i += hdr -> bLength )
+    {
+        hdr = ( struct usb_desc_hdr * ) ( ( uint8_t * ) ( dev -> conf_desc ) + i );
+
+        // Only wTotalLength bytes were read from the device
+        if ( i + sizeof ( struct usb_desc_hdr ) > total ||
+                i + hdr -> bLength > total )
+        {
+            printuln ( "Descriptor truncated by wTotalLength" );
+            return -1;
+        }
+
+        if ( hdr -> bLength < sizeof ( struct usb_desc_hdr ) )
+        {
+            printuln ( "Invalid bLength in configuration descriptor header" );
+            return -1;
+        }
+
+        switch ( hdr -> bDescriptorType )
+        {
+            case USB_DESC_INTF:
+                intf = ( struct usb_intf_desc * ) hdr;
+
+                // TODO: Handle alternate settings
+                if ( intf -> bAlternateSetting != 0 )
+                {
+                    printuln ( "Skipping alternate settings intf..." );
+                    break;
+                }
+
+                if ( ++intf_idx >= USB_MAX_INTF )
+                {
+                    printuln ( "Too many interfaces" );
+                    return -1;
+                }
+                if ( intf_idx >= dev -> conf_desc -> bNumInterfaces )
+                {
+                    printuln ( "bNumInterfaces mismatch" );
+                    return -1;
+                }
+
+                dev -> intf_desc [ intf_idx ] = intf;
+                endp_idx = -1;
+                break;
+
+            case USB_DESC_ENDP:
+                if ( intf_idx < 0 )
+                {
+                    printuln ( "Endpoint belonging to no Interface" );
+                    return -1;
+                }
+
+                // TODO: Handle alternate settings
+                if ( intf -> bAlternateSetting != 0 )
+                {
+                    printuln ( "Skipping endp of alternate settings intf..." );
+                    break;
+                }
+
+                endp = ( struct usb_endp_desc * ) hdr;
+
+                if ( ++endp_idx >= USB_MAX_ENDP )
+                {
+                    printuln ( "Too many endpoints" );
+                    return -1;
+                }
+                if ( endp_idx >= intf -> bNumEndpoints )
+                {
+                    printuln ( "bNumEnpoints mismatch" );
+                    return -1;
+                }
+
+                dev -> endp_desc [ intf_idx ] [ endp_idx ] = endp;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    return USB_STATUS_SUCCESS;
+}
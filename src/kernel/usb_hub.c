@@ -3,6 +3,7 @@
 #include "usb_core.h"
 
 #include "arm.h"
+#include "spsc_ring.h"
 #include "semaphore.h"
 #include "../api/process.h"
 
@@ -40,9 +41,20 @@ struct usb_hub_port
     struct usb_device * child;
 };
 
-static sem_t usb_hub_sem;
 static struct usb_hub usb_hubs [ USB_MAX_HUB ];
-static uint32_t usb_hub_pending;
+
+/* IDs of the hubs whose status changed, one ring per producer: the root hub
+ * completes from the HCD thread, the other hubs from the USB bottom half. A
+ * hub never has more than one Status Changed request in flight, so the rings
+ * can never overflow. */
+static struct spsc_ring usb_hub_events;
+static uint32_t usb_hub_events_buf [ USB_MAX_HUB ];
+static struct spsc_ring usb_hub_root_events;
+static uint32_t usb_hub_root_events_buf [ 1 ];
+static int usb_hub_driver_ready;
+
+// Held by the hub thread while it changes the device tree, see usb_foreach_root
+static sem_t usb_hub_tree_lock;
 
 extern struct usb_device * usb_root;
 
@@ -191,7 +203,7 @@ static int usb_hub_port_reset ( struct usb_hub * hub, uint16_t port )
     for ( ; hub -> ports [ port ].status.reset ; delay += USB_HUB_RST_DELAY )
     {
         printuln ( "USB Hub Port Reset wait" );
-        cdelay ( USB_HUB_RST_DELAY * 1000 * 7 );
+        api_process_msleep ( USB_HUB_RST_DELAY );
 
         // Refresh the port status
         status = usb_hub_read_port_status ( hub, port );
@@ -210,7 +222,7 @@ static int usb_hub_port_reset ( struct usb_hub * hub, uint16_t port )
 
     // Allow for the recovery interval
     // The USB spec requires 10ms at least. Here, we wait 3 times this interval.
-    cdelay ( 3 * USB_HUB_RST_RECOVERY_INTERVAL * 1000 * 7 );
+    api_process_msleep ( 3 * USB_HUB_RST_RECOVERY_INTERVAL );
     return USB_STATUS_SUCCESS;
 }
 
@@ -375,7 +387,6 @@ static void usb_hub_hub_changed ( struct usb_hub * hub )
 
 static void usb_hub_status_changed_worker ( )
 {
-    uint32_t irqmask;
     struct usb_hub * hub;
     uint32_t hub_id;
 
@@ -383,24 +394,18 @@ static void usb_hub_status_changed_worker ( )
     uint16_t port;
     size_t s;
 
+    struct spsc_ring * events [ ] = { &usb_hub_events, &usb_hub_root_events };
+
     for ( ; ; )
     {
-        // Wait for a Hub IRQ to occur
-        wait ( usb_hub_sem );
-
-        // Determine which Hub has a pending IRQ
-        irqmask = irq_disable ( );
-        if ( ! usb_hub_pending )
-        {
-            irq_restore ( irqmask );
-            continue;
-        }
-        hub_id = 31 - __builtin_clz ( usb_hub_pending );
-        usb_hub_pending ^= ( 1 << hub_id );
-        irq_restore ( irqmask );
+        // Wait for a Hub IRQ to occur and determine which Hub it was
+        spsc_ring_pop_wait_any ( events, 2, &hub_id );
 
         hub = &usb_hubs [ hub_id ];
 
+        // Devices may be enumerated or freed
+        wait ( usb_hub_tree_lock );
+
         // Process each status byte
         for ( s = 0 ; s < hub -> changed_size; ++s )
         {
@@ -427,6 +432,8 @@ static void usb_hub_status_changed_worker ( )
             }
         }
 
+        signal ( usb_hub_tree_lock );
+
         // Re-submit USB Hub IRQ request
         usb_submit_request ( hub -> status_changed_req );
     }
@@ -434,7 +441,6 @@ static void usb_hub_status_changed_worker ( )
 
 void usb_hub_status_changed_request_done ( struct usb_request * req )
 {
-    uint32_t irqmask;
     uint32_t hub_id;
     struct usb_hub * hub;
     size_t size;
@@ -459,24 +465,34 @@ void usb_hub_status_changed_request_done ( struct usb_request * req )
     // Determine the Hub ID
     hub_id = hub - usb_hubs;
 
-    // Mark the Hub has having a pending Hub IRQ
-    irqmask = irq_disable ( );
-    usb_hub_pending |= ( 1 << hub_id );
-    irq_restore ( irqmask );
-
-    // Tell the Hub IRQ processing thread!
-    signal ( usb_hub_sem );
+    // Tell the Hub IRQ processing thread, on the ring of this producer
+    if ( ! req -> dev -> parent )
+    {
+        spsc_ring_push ( &usb_hub_root_events, hub_id );
+    }
+    else
+    {
+        spsc_ring_push ( &usb_hub_events, hub_id );
+    }
 }
 
 static int usb_hub_driver_init ( )
 {
-    sem_t sem = sem_create ( 0 );
-    if ( sem < 0 )
+    if ( spsc_ring_init ( &usb_hub_events, usb_hub_events_buf, USB_MAX_HUB ) != 0 ||
+         spsc_ring_init ( &usb_hub_root_events, usb_hub_root_events_buf, 1 ) != 0 )
+    {
+        return -1;
+    }
+
+    spsc_ring_share_waiter ( &usb_hub_root_events, &usb_hub_events );
+
+    usb_hub_tree_lock = sem_create ( 1 );
+    if ( usb_hub_tree_lock < 0 )
     {
         return -1;
     }
 
-    usb_hub_sem = sem;
+    usb_hub_driver_ready = 1;
     api_process_create ( usb_hub_status_changed_worker, 0 );
 
     return 0;
@@ -504,9 +520,23 @@ void usb_foreach ( struct usb_device * dev, usb_foreach_func_t f )
     f ( dev );
 }
 
+int usb_foreach_root ( usb_foreach_func_t f )
+{
+    if ( ! usb_root || ! usb_hub_driver_ready )
+    {
+        return -1;
+    }
+
+    wait ( usb_hub_tree_lock );
+    usb_foreach ( usb_root, f );
+    signal ( usb_hub_tree_lock );
+
+    return 0;
+}
+
 int usb_hub_probe ( struct usb_device * dev )
 {
-    if ( ! usb_hub_sem )
+    if ( ! usb_hub_driver_ready )
     {
         if ( usb_hub_driver_init ( ) != 0 )
         {
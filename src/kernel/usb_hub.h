@@ -9,4 +9,12 @@ typedef void ( * usb_foreach_func_t ) ( struct usb_device * );
 
 void usb_foreach ( struct usb_device * dev, usb_foreach_func_t );
 
+/*
+ * Calls f on every device of the tree, children before their hub, while the
+ * hub thread can't change the tree. Not for IRQ context, nor for the hub
+ * thread itself.
+ * @return 0 on success, -1 if there is no root hub (yet).
+ */
+int usb_foreach_root ( usb_foreach_func_t f );
+
 #endif
@@ -0,0 +1,32 @@
+#ifndef _H_LIB_CHECKSUM
+#define _H_LIB_CHECKSUM
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Internet checksum (RFC 1071): the complement of the one's complement sum
+ * of the data, as 16-bit big-endian words. It is returned in memory order,
+ * ready to be stored as is in a header, and comes out 0 over data which
+ * includes its own checksum.
+ * inet_checksum_partial adds data to the sum of previous chunks (0 for the
+ * first one), for headers and payloads in separate buffers: all chunks but
+ * the last must have an even size.
+ * Implemented in ARM assembly (checksum.s).
+ */
+uint16_t inet_checksum ( const void * data, size_t n );
+uint32_t inet_checksum_partial ( const void * data, size_t n, uint32_t sum );
+
+// Complement of the sum of the chunks, see inet_checksum_partial
+static inline uint16_t inet_checksum_finish ( uint32_t sum )
+{
+    return ~sum & 0xffff;
+}
+
+/*
+ * CRC-32 (IEEE 802.3, as Ethernet and zlib): crc is 0 for the first chunk,
+ * the previous result for the next ones.
+ */
+uint32_t crc32 ( uint32_t crc, const void * data, size_t n );
+
+#endif
@@ -0,0 +1,127 @@
+@ vim: ft=arm
+.syntax unified
+
+/* Checksums for the ARM1176, see checksum.h. */
+
+/* uint32_t inet_checksum_partial ( const void * data, size_t n, uint32_t sum )
+ * Words are summed with an add-with-carry chain, 32 bytes per ldm: adding
+ * 32 bits at a time and folding the carries at the end gives the same one's
+ * complement sum as adding 16 bits at a time (UADD16 would drop the carries).
+ * Bytes are added at their place in the word, given by their address: data
+ * starting at an odd address comes out byte swapped, which is undone once
+ * folded. */
+.globl inet_checksum_partial
+inet_checksum_partial:
+    push {r4-r10, lr}
+    mov r10, r0
+
+    @ Swapped on the way in, so that it is back in place on the way out
+    tst r10, #1
+    rev16ne r2, r2
+
+    @ Head bytes, up to a word boundary
+1:
+    tst r0, #3
+    beq 2f
+    subs r1, r1, #1
+    blo 8f
+    and r3, r0, #3
+    ldrb r4, [r0], #1
+    lsl r3, r3, #3
+    adds r2, r2, r4, lsl r3
+    adc r2, r2, #0
+    b 1b
+
+2:
+    subs r1, r1, #32
+    blo 4f
+3:
+    ldmia r0!, {r3-r9, lr}
+    adds r2, r2, r3
+    adcs r2, r2, r4
+    adcs r2, r2, r5
+    adcs r2, r2, r6
+    adcs r2, r2, r7
+    adcs r2, r2, r8
+    adcs r2, r2, r9
+    adcs r2, r2, lr
+    adc r2, r2, #0
+    subs r1, r1, #32
+    bhs 3b
+4:
+    adds r1, r1, #28
+    blo 6f
+5:
+    ldr r3, [r0], #4
+    adds r2, r2, r3
+    adc r2, r2, #0
+    subs r1, r1, #4
+    bhs 5b
+6:
+    add r1, r1, #4
+
+    @ Tail bytes
+7:
+    subs r1, r1, #1
+    blo 8f
+    and r3, r0, #3
+    ldrb r4, [r0], #1
+    lsl r3, r3, #3
+    adds r2, r2, r4, lsl r3
+    adc r2, r2, #0
+    b 7b
+
+    @ Fold the carries back in, twice: 32 bits to 17, then 16
+8:
+    lsr r3, r2, #16
+    uxtah r2, r3, r2
+    lsr r3, r2, #16
+    uxtah r2, r3, r2
+
+    tst r10, #1
+    rev16ne r2, r2
+
+    mov r0, r2
+    pop {r4-r10, pc}
+
+@ uint16_t inet_checksum ( const void * data, size_t n )
+.globl inet_checksum
+inet_checksum:
+    push {r4, lr}
+    mov r2, #0
+    bl inet_checksum_partial
+    mvn r0, r0
+    uxth r0, r0
+    pop {r4, pc}
+
+/* uint32_t crc32_words ( uint32_t crc, const void * data, size_t nwords,
+ *      const uint32_t tables [ 4 ] [ 256 ] )
+ * Slicing by 4: one table lookup per byte of each word, all independent.
+ * data must be word aligned, crc is neither inverted on the way in nor on
+ * the way out. */
+.globl crc32_words
+crc32_words:
+    push {r4-r7, lr}
+    add r5, r3, #1024
+    add r6, r3, #2048
+    add r7, r3, #3072
+1:
+    subs r2, r2, #1
+    blo 2f
+    ldr r12, [r1], #4
+    eor r0, r0, r12
+
+    uxtb r12, r0
+    ldr r12, [r7, r12, lsl #2]
+    uxtb lr, r0, ror #8
+    ldr lr, [r6, lr, lsl #2]
+    eor r12, r12, lr
+    uxtb lr, r0, ror #16
+    ldr lr, [r5, lr, lsl #2]
+    eor r12, r12, lr
+    lsr lr, r0, #24
+    ldr lr, [r3, lr, lsl #2]
+    eor r0, r12, lr
+    b 1b
+2:
+    pop {r4-r7, pc}
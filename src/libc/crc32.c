@@ -0,0 +1,70 @@
+#include "checksum.h"
+
+// Reflected polynomial of the CRC-32
+#define CRC32_POLY 0xedb88320
+
+/* crc32_tables [ 0 ] is the usual byte table. crc32_tables [ k ] [ b ] is
+ * the CRC of byte b followed by k zero bytes, so that the four bytes of a
+ * word are looked up independently. Built on first use. */
+static uint32_t crc32_tables [ 4 ] [ 256 ];
+static volatile int crc32_ready;
+
+uint32_t crc32_words ( uint32_t crc, const void * data, size_t nwords,
+        const uint32_t tables [ 4 ] [ 256 ] );
+
+static void crc32_init ( )
+{
+    for ( uint32_t b = 0 ; b < 256 ; ++b )
+    {
+        uint32_t crc = b;
+
+        for ( int bit = 0 ; bit < 8 ; ++bit )
+        {
+            crc = ( crc & 1 ) ? ( crc >> 1 ) ^ CRC32_POLY : crc >> 1;
+        }
+
+        crc32_tables [ 0 ] [ b ] = crc;
+    }
+
+    for ( int k = 1 ; k < 4 ; ++k )
+    {
+        for ( uint32_t b = 0 ; b < 256 ; ++b )
+        {
+            uint32_t prev = crc32_tables [ k - 1 ] [ b ];
+            crc32_tables [ k ] [ b ] = ( prev >> 8 ) ^ crc32_tables [ 0 ] [ prev & 0xff ];
+        }
+    }
+
+    // Concurrent first calls just compute the same tables
+    crc32_ready = 1;
+}
+
+uint32_t crc32 ( uint32_t crc, const void * data, size_t n )
+{
+    const uint8_t * p = data;
+
+    if ( ! crc32_ready )
+    {
+        crc32_init ( );
+    }
+
+    crc = ~crc;
+
+    // Bytes up to a word boundary, words, then the last bytes
+    while ( n && ( ( uintptr_t ) p & 3 ) )
+    {
+        crc = ( crc >> 8 ) ^ crc32_tables [ 0 ] [ ( crc ^ * p++ ) & 0xff ];
+        n--;
+    }
+
+    crc = crc32_words ( crc, p, n / 4, crc32_tables );
+    p += n & ~3;
+    n &= 3;
+
+    while ( n-- )
+    {
+        crc = ( crc >> 8 ) ^ crc32_tables [ 0 ] [ ( crc ^ * p++ ) & 0xff ];
+    }
+
+    return ~crc;
+}
@@ -3,7 +3,14 @@
 
 #include <stddef.h>
 
+/*
+ * Implemented in ARM assembly (string.s): word and 32 bytes block transfers
+ * whatever the alignment of the source, see src/apps/bench_copy.c.
+ */
 void * memcpy ( void * dest, const void * src, size_t n );
+void * memmove ( void * dest, const void * src, size_t n );
 void * memset ( void * s, int c, size_t n);
+int memcmp ( const void * s1, const void * s2, size_t n );
+size_t strlen ( const char * s );
 
 #endif
@@ -0,0 +1,276 @@
+@ vim: ft=arm
+.syntax unified
+
+/* Memory and string functions for the ARM1176, see string.h.
+ * Copies and fills go word by word, and 32 bytes per ldm/stm pair once the
+ * destination is word aligned. A misaligned source is read by aligned words
+ * anyway, which are shifted into place. Small sizes fall back to bytes. */
+
+/* Rest of copy_forward, for a source k bytes past a word boundary */
+.macro copy_forward_shifted k
+    @ The first word holds 4 - k bytes to copy, at the top
+    bic r1, r1, #3
+    ldr r3, [r1], #4
+    subs r2, r2, #16
+    blo 2f
+1:
+    ldmia r1!, {r4-r7}
+    lsr r3, r3, #(8 * \k)
+    orr r3, r3, r4, lsl #(32 - 8 * \k)
+    lsr r4, r4, #(8 * \k)
+    orr r4, r4, r5, lsl #(32 - 8 * \k)
+    lsr r5, r5, #(8 * \k)
+    orr r5, r5, r6, lsl #(32 - 8 * \k)
+    lsr r6, r6, #(8 * \k)
+    orr r6, r6, r7, lsl #(32 - 8 * \k)
+    stmia r0!, {r3-r6}
+    mov r3, r7
+    subs r2, r2, #16
+    bhs 1b
+2:
+    adds r2, r2, #12
+    blo 4f
+3:
+    ldr r4, [r1], #4
+    lsr r3, r3, #(8 * \k)
+    orr r3, r3, r4, lsl #(32 - 8 * \k)
+    str r3, [r0], #4
+    mov r3, r4
+    subs r2, r2, #4
+    bhs 3b
+4:
+    @ Back to the first byte not copied yet
+    add r2, r2, #4
+    sub r1, r1, #(4 - \k)
+    b copy_forward_bytes
+.endm
+
+/* Forward copy of r2 bytes from r1 to r0, for memcpy and memmove.
+ * Clobbers r1-r10, r12. */
+copy_forward:
+    cmp r2, #8
+    blo copy_forward_bytes
+
+    @ Align the destination
+1:
+    tst r0, #3
+    beq 2f
+    ldrb r3, [r1], #1
+    strb r3, [r0], #1
+    sub r2, r2, #1
+    b 1b
+2:
+    ands r12, r1, #3
+    bne copy_forward_misaligned
+
+    subs r2, r2, #32
+    blo 4f
+3:
+    ldmia r1!, {r3-r10}
+    stmia r0!, {r3-r10}
+    subs r2, r2, #32
+    bhs 3b
+4:
+    adds r2, r2, #28
+    blo 6f
+5:
+    ldr r3, [r1], #4
+    str r3, [r0], #4
+    subs r2, r2, #4
+    bhs 5b
+6:
+    add r2, r2, #4
+
+copy_forward_bytes:
+    subs r2, r2, #1
+    ldrbhs r3, [r1], #1
+    strbhs r3, [r0], #1
+    bhs copy_forward_bytes
+    bx lr
+
+copy_forward_misaligned:
+    cmp r12, #2
+    beq copy_forward_shift2
+    bhi copy_forward_shift3
+    copy_forward_shifted 1
+copy_forward_shift2:
+    copy_forward_shifted 2
+copy_forward_shift3:
+    copy_forward_shifted 3
+
+@ void * memcpy ( void * dest, const void * src, size_t n )
+.globl memcpy
+memcpy:
+    push {r0, r4-r10, lr}
+    bl copy_forward
+    pop {r0, r4-r10, pc}
+
+@ void * memmove ( void * dest, const void * src, size_t n )
+.globl memmove
+memmove:
+    push {r0, r4-r10, lr}
+
+    @ Forward, unless dest lies within the source
+    sub r3, r0, r1
+    cmp r3, r2
+    blo 1f
+    bl copy_forward
+    pop {r0, r4-r10, pc}
+
+    @ Backward, from the ends
+1:
+    add r0, r0, r2
+    add r1, r1, r2
+    cmp r2, #8
+    blo 8f
+2:
+    tst r0, #3
+    beq 3f
+    ldrb r3, [r1, #-1]!
+    strb r3, [r0, #-1]!
+    sub r2, r2, #1
+    b 2b
+3:
+    @ Misaligned overlapping moves are rare: bytes will do
+    tst r1, #3
+    bne 8f
+
+    subs r2, r2, #32
+    blo 5f
+4:
+    ldmdb r1!, {r3-r10}
+    stmdb r0!, {r3-r10}
+    subs r2, r2, #32
+    bhs 4b
+5:
+    adds r2, r2, #28
+    blo 7f
+6:
+    ldr r3, [r1, #-4]!
+    str r3, [r0, #-4]!
+    subs r2, r2, #4
+    bhs 6b
+7:
+    add r2, r2, #4
+8:
+    subs r2, r2, #1
+    ldrbhs r3, [r1, #-1]!
+    strbhs r3, [r0, #-1]!
+    bhs 8b
+    pop {r0, r4-r10, pc}
+
+@ void * memset ( void * s, int c, size_t n )
+.globl memset
+memset:
+    push {r0, r4-r8, lr}
+
+    @ The byte, in the 4 bytes of a word
+    and r1, r1, #0xff
+    orr r1, r1, r1, lsl #8
+    orr r1, r1, r1, lsl #16
+
+    cmp r2, #8
+    blo 7f
+1:
+    tst r0, #3
+    beq 2f
+    strb r1, [r0], #1
+    sub r2, r2, #1
+    b 1b
+2:
+    mov r3, r1
+    mov r4, r1
+    mov r5, r1
+    mov r6, r1
+    mov r7, r1
+    mov r8, r1
+    mov r12, r1
+
+    subs r2, r2, #32
+    blo 4f
+3:
+    stmia r0!, {r1, r3-r8, r12}
+    subs r2, r2, #32
+    bhs 3b
+4:
+    adds r2, r2, #28
+    blo 6f
+5:
+    str r1, [r0], #4
+    subs r2, r2, #4
+    bhs 5b
+6:
+    add r2, r2, #4
+7:
+    subs r2, r2, #1
+    strbhs r1, [r0], #1
+    bhs 7b
+    pop {r0, r4-r8, pc}
+
+@ int memcmp ( const void * s1, const void * s2, size_t n )
+.globl memcmp
+memcmp:
+    @ Word by word when both are aligned, until the first difference
+    orr r3, r0, r1
+    tst r3, #3
+    bne 3f
+1:
+    subs r2, r2, #4
+    blo 2f
+    ldr r3, [r0], #4
+    ldr r12, [r1], #4
+    cmp r3, r12
+    beq 1b
+
+    @ Which byte differs: let the byte loop find it
+    sub r0, r0, #4
+    sub r1, r1, #4
+2:
+    add r2, r2, #4
+3:
+    subs r2, r2, #1
+    blo 4f
+    ldrb r3, [r0], #1
+    ldrb r12, [r1], #1
+    subs r3, r3, r12
+    beq 3b
+    mov r0, r3
+    bx lr
+4:
+    mov r0, #0
+    bx lr
+
+@ size_t strlen ( const char * s )
+.globl strlen
+strlen:
+    mov r1, r0
+1:
+    tst r1, #3
+    beq 2f
+    ldrb r2, [r1], #1
+    cmp r2, #0
+    bne 1b
+    b 4f
+
+    @ A word holds a zero byte iff (w - 0x01010101) & ~w & 0x80808080
+2:
+    ldr r3, =0x01010101
+3:
+    ldr r2, [r1], #4
+    sub r12, r2, r3
+    bic r12, r12, r2
+    tst r12, r3, lsl #7
+    beq 3b
+
+    @ Find which one
+    sub r1, r1, #4
+5:
+    ldrb r2, [r1], #1
+    cmp r2, #0
+    bne 5b
+4:
+    sub r0, r1, r0
+    sub r0, r0, #1
+    bx lr
+
+.ltorg